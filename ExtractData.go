@@ -5,33 +5,29 @@ import (
 	"context"
 	"database/sql"
 	"encoding/csv"
+	"errors"
 	"fmt"
 	"log/slog"
 	"os"
 	"path/filepath"
-	"runtime"
 	"slices"
 	"strconv"
 	"strings"
 	"sync"
+	"sync/atomic"
 	"time"
 )
 
-// Memory pools for performance optimization
+// Scan destination pools for performance optimization
 var (
 	scanArgsPool = sync.Pool{
 		New: func() interface{} {
 			return make([]interface{}, 0, 50) // Pre-allocate capacity for 50 columns
 		},
 	}
-	valuesPool = sync.Pool{
+	rawValuesPool = sync.Pool{
 		New: func() interface{} {
-			return make([]sql.NullString, 0, 50) // Pre-allocate capacity for 50 columns
-		},
-	}
-	stringBuilderPool = sync.Pool{
-		New: func() interface{} {
-			return &strings.Builder{}
+			return make([]sql.RawBytes, 0, 50) // Pre-allocate capacity for 50 columns
 		},
 	}
 )
@@ -40,109 +36,135 @@ var (
 
 var globalStmtCache = NewPreparedStmtCache()
 
-func runExtractionForSol(ctx context.Context, db *sql.DB, solID string, procConfig *ExtractionConfig, templates map[string][]ColumnConfig, logCh chan<- ProcLog, mu *sync.Mutex, summary map[string]ProcSummary) {
-	var wg sync.WaitGroup
-	procCh := make(chan string)
-
-	numWorkers := runtime.NumCPU() * 2
-	for range numWorkers {
-		wg.Add(1)
-		go func() {
-			defer wg.Done()
-			for proc := range procCh {
-				start := time.Now()
-
-				// Check if this procedure uses chunked logic
-				if isChunkedProcedure(proc, procConfig.ChunkedProcedures) {
-					slog.Debug("Starting chunked extraction", "procedure", proc, "sol_id", solID)
-					chunkResultsCh := make(chan ChunkResult, 100)
-					runChunkedExtractionForSol(ctx, db, solID, proc, procConfig, templates, logCh, chunkResultsCh)
-					close(chunkResultsCh)
-
-					// Process chunk results for summary
-					for result := range chunkResultsCh {
-						mu.Lock()
-						s, exists := summary[result.Procedure]
-						if !exists {
-							s = ProcSummary{
-								Procedure: result.Procedure,
-								StartTime: result.StartTime,
-								EndTime:   result.EndTime,
-								Status:    result.Status,
-							}
-						} else {
-							if result.StartTime.Before(s.StartTime) {
-								s.StartTime = result.StartTime
-							}
-							if result.EndTime.After(s.EndTime) {
-								s.EndTime = result.EndTime
-							}
-							if s.Status != "FAIL" && result.Status == "FAIL" {
-								s.Status = "FAIL"
-							}
-						}
-						summary[result.Procedure] = s
-						mu.Unlock()
-					}
-				} else {
-					// Regular extraction logic
-					slog.Debug("Starting extraction", "procedure", proc, "sol_id", solID)
-					err := extractData(ctx, db, proc, solID, procConfig, templates)
-					end := time.Now()
-
-					plog := ProcLog{
-						SolID:         solID,
-						Procedure:     proc,
-						StartTime:     start,
-						EndTime:       end,
-						ExecutionTime: end.Sub(start),
-					}
-					if err != nil {
-						plog.Status = "FAIL"
-						plog.ErrorDetails = err.Error()
-					} else {
-						plog.Status = "SUCCESS"
-					}
-					logCh <- plog
-
-					mu.Lock()
-					s, exists := summary[proc]
-					if !exists {
-						s = ProcSummary{Procedure: proc, StartTime: start, EndTime: end, Status: plog.Status}
-					} else {
-						if start.Before(s.StartTime) {
-							s.StartTime = start
-						}
-						if end.After(s.EndTime) {
-							s.EndTime = end
-						}
-						if s.Status != "FAIL" && plog.Status == "FAIL" {
-							s.Status = "FAIL"
-						}
-					}
-					summary[proc] = s
-					mu.Unlock()
-					slog.Debug("Completed extraction", 
-						"procedure", proc, 
-						"sol_id", solID, 
-						"duration", end.Sub(start).Round(time.Millisecond).String())
+// runExtraction extracts every (SOL, procedure) task through the shared scheduler. With
+// sol_batch_size > 1 a task covers a batch of SOLs with one set-based query; chunked
+// procedures always take one SOL per task. outputs is nil in spool mode.
+func runExtraction(ctx context.Context, db *sql.DB, sols []string, procConfig *ExtractionConfig, templates map[string]*Template, outputs map[string]*ProcOutput, logCh chan<- ProcLog, summary *ProcSummaries, limiter *AIMDLimiter, maxWorkers int, history *TaskHistory) {
+	tasks := buildExtractionTasks(sols, procConfig, history)
+	if outputs == nil {
+		sortLongestFirst(tasks)
+	} else {
+		// Direct outputs only make progress if each procedure's SOLs start in sequence order.
+		// Reordering even within a window could fill the reorder buffer with later SOLs
+		// while the one it waits for is not started, so the longest-first tail gain is given up.
+		slog.Info("Direct output keeps tasks in SOL order instead of longest first")
+	}
+
+	totalTasks := len(tasks)
+	overallStart := time.Now()
+	var completed atomic.Int64
+	runScheduled(limiter, maxWorkers, feedTasks(tasks), func(task SchedTask) {
+		switch {
+		case isChunkedProcedure(task.Proc, procConfig.ChunkedProcedures):
+			runChunkedProcedureForSol(ctx, db, task.SolIDs[0], task.Proc, procConfig, templates, logCh, summary)
+		case len(task.SolIDs) > 1:
+			extractProcedureForBatch(ctx, db, task.Proc, task.SolIDs, task.Seq, procConfig, templates, outputs[task.Proc], logCh, summary)
+		default:
+			solID := task.SolIDs[0]
+			slog.Debug("Starting extraction", "procedure", task.Proc, "sol_id", solID)
+			start := time.Now()
+			err := extractData(ctx, db, task.Proc, solID, procConfig, templates, outputs[task.Proc], task.Seq)
+			end := time.Now()
+			recordExtraction(logCh, summary, solID, task.Proc, start, end, err)
+			slog.Debug("Completed extraction",
+				"procedure", task.Proc,
+				"sol_id", solID,
+				"duration", end.Sub(start).Round(time.Millisecond).String())
+		}
+
+		done := int(completed.Add(1))
+		if done%100 == 0 || done == totalTasks {
+			elapsed := time.Since(overallStart)
+			estimatedTotal := time.Duration(float64(elapsed) / float64(done) * float64(totalTasks))
+			eta := estimatedTotal - elapsed
+			slog.Info("Extraction progress",
+				"completed_tasks", done,
+				"total_tasks", totalTasks,
+				"progress_percent", fmt.Sprintf("%.2f", float64(done)*100/float64(totalTasks)),
+				"concurrency_limit", limiter.Limit(),
+				"elapsed", elapsed.Round(time.Second).String(),
+				"eta", eta.Round(time.Second).String())
+		}
+	})
+}
+
+// buildExtractionTasks lists the run's tasks in SOL order, weighted by the previous run
+func buildExtractionTasks(sols []string, procConfig *ExtractionConfig, history *TaskHistory) []SchedTask {
+	batchSize := max(procConfig.SolBatchSize, 1)
+	tasks := make([]SchedTask, 0, len(sols)*len(procConfig.Procedures)/batchSize+1)
+	for seq := 0; seq < len(sols); seq += batchSize {
+		batch := sols[seq:min(seq+batchSize, len(sols))]
+		for _, proc := range procConfig.Procedures {
+			if len(batch) > 1 && isChunkedProcedure(proc, procConfig.ChunkedProcedures) {
+				for i := range batch {
+					solIDs := batch[i : i+1]
+					tasks = append(tasks, SchedTask{Proc: proc, SolIDs: solIDs, Seq: seq + i, Weight: history.Weight(proc, solIDs)})
 				}
+				continue
 			}
-		}()
+			tasks = append(tasks, SchedTask{Proc: proc, SolIDs: batch, Seq: seq, Weight: history.Weight(proc, batch)})
+		}
 	}
+	return tasks
+}
 
-	for _, proc := range procConfig.Procedures {
-		procCh <- proc
+// runChunkedProcedureForSol runs a chunked procedure for one SOL and folds its chunk results into the summary
+func runChunkedProcedureForSol(ctx context.Context, db *sql.DB, solID, proc string, procConfig *ExtractionConfig, templates map[string]*Template, logCh chan<- ProcLog, summary *ProcSummaries) {
+	slog.Debug("Starting chunked extraction", "procedure", proc, "sol_id", solID)
+	chunkResultsCh := make(chan ChunkResult, 100)
+	runChunkedExtractionForSol(ctx, db, solID, proc, procConfig, templates, logCh, chunkResultsCh)
+	close(chunkResultsCh)
+
+	// Process chunk results for summary
+	for result := range chunkResultsCh {
+		summary.Record(result.Procedure, result.StartTime, result.EndTime, result.Status)
+	}
+}
+
+// recordExtraction logs the outcome of one (SOL, procedure) extraction and folds it into the summary
+func recordExtraction(logCh chan<- ProcLog, summary *ProcSummaries, solID, proc string, start, end time.Time, err error) {
+	plog := ProcLog{
+		SolID:         solID,
+		Procedure:     proc,
+		StartTime:     start,
+		EndTime:       end,
+		ExecutionTime: end.Sub(start),
+	}
+	if err != nil {
+		plog.Status = "FAIL"
+		plog.ErrorDetails = err.Error()
+	} else {
+		plog.Status = "SUCCESS"
 	}
-	close(procCh)
-	wg.Wait()
+	sendProcLog(logCh, plog)
+
+	summary.Record(proc, start, end, plog.Status)
 }
 
-func extractData(ctx context.Context, db *sql.DB, procName, solID string, cfg *ExtractionConfig, templates map[string][]ColumnConfig) error {
-	cols, ok := templates[procName]
+// extractData runs the SOL query for one procedure and encodes its rows. With a direct
+// output the rows go into one segment committed at position seq (empty on failure, so
+// the output can advance); otherwise they are written to a <proc>_<sol>.spool file.
+// Procedures listed in native_fetch_procedures read rows on the driver connection and
+// fall back to database/sql if the driver does not support it.
+func extractData(ctx context.Context, db *sql.DB, procName, solID string, cfg *ExtractionConfig, templates map[string]*Template, out *ProcOutput, seq int) (err error) {
+	var segment *[]byte
+	if out != nil {
+		segment = getSegment()
+		defer func() {
+			if err != nil {
+				*segment = (*segment)[:0]
+			}
+			commitStart := time.Now()
+			out.Commit(seq, segment)
+			globalMetrics.RecordPhase(procName, PhaseWrite, time.Since(commitStart))
+		}()
+	}
+
+	tmpl, ok := templates[procName]
 	if !ok {
 		return fmt.Errorf("missing template for procedure %s", procName)
 	}
+	cols := tmpl.Columns
 
 	colNames := make([]string, len(cols))
 	for i, col := range cols {
@@ -151,87 +173,109 @@ func extractData(ctx context.Context, db *sql.DB, procName, solID string, cfg *E
 
 	query := fmt.Sprintf("SELECT %s FROM %s WHERE SOL_ID = :1", strings.Join(colNames, ", "), procName)
 	start := time.Now()
-	
-	// Use prepared statement cache for better performance
-	stmt, err := globalStmtCache.GetOrPrepare(db, query)
-	if err != nil {
-		return fmt.Errorf("failed to prepare statement: %w", err)
+	consume := func(src rowSource) error {
+		slog.Debug("Query executed", 
+			"procedure", procName, 
+			"sol_id", solID, 
+			"duration", time.Since(start).Round(time.Millisecond).String())
+		return encodeRows(procName, solID, cfg, tmpl, segment, src, start)
 	}
-	
-	rows, err := stmt.QueryContext(ctx, solID)
-	if err != nil {
-		return fmt.Errorf("query failed: %w", err)
-	}
-	defer rows.Close()
-	slog.Debug("Query executed", 
-		"procedure", procName, 
-		"sol_id", solID, 
-		"duration", time.Since(start).Round(time.Millisecond).String())
-
-	spoolPath := filepath.Join(cfg.SpoolOutputPath, fmt.Sprintf("%s_%s.spool", procName, solID))
-	f, err := os.Create(spoolPath)
-	if err != nil {
-		return err
+
+	if isNativeFetchProcedure(procName, cfg.NativeFetchProcedures) {
+		err = queryNative(ctx, db, procName, query, tmpl, []interface{}{solID}, consume)
+		if !errors.Is(err, errNativeFetchUnsupported) {
+			return err
+		}
+		nativeFetchFallback.Do(func() {
+			slog.Warn("Native fetch unsupported by the driver, using database/sql", "procedure", procName)
+		})
 	}
-	defer f.Close()
+	return querySQL(ctx, db, procName, query, tmpl, []interface{}{solID}, consume)
+}
 
-	// Use larger buffer for better I/O performance (128KB)
-	buf := bufio.NewWriterSize(f, 128*1024)
-	defer buf.Flush()
+// nativeFetchFallback logs the fallback from native fetch once per run
+var nativeFetchFallback sync.Once
+
+// encodeRows encodes a query's rows into the segment, or into the SOL's spool file when
+// segment is nil, and records the fetch, encode and write phases and the query metrics
+func encodeRows(procName, solID string, cfg *ExtractionConfig, tmpl *Template, segment *[]byte, src rowSource, start time.Time) error {
+	var buf *bufio.Writer
+	if segment == nil {
+		spoolPath := filepath.Join(cfg.SpoolOutputPath, fmt.Sprintf("%s_%s.spool", procName, solID))
+		f, err := os.Create(spoolPath)
+		if err != nil {
+			return err
+		}
+		defer f.Close()
+
+		// Use larger buffer for better I/O performance (128KB)
+		buf = bufio.NewWriterSize(f, 128*1024)
+		defer buf.Flush()
+	}
 
 	rowCount := int64(0)
 	totalBytes := int64(0)
-	
-	for rows.Next() {
-		// Get objects from pools to reduce allocations
-		values := valuesPool.Get().([]sql.NullString)
-		scanArgs := scanArgsPool.Get().([]interface{})
-		
-		// Resize slices if needed
-		if cap(values) < len(cols) {
-			values = make([]sql.NullString, len(cols))
-		} else {
-			values = values[:len(cols)]
+
+	linePtr := lineBufferPool.Get().(*[]byte)
+	line := *linePtr
+	defer func() {
+		*linePtr = line[:0]
+		lineBufferPool.Put(linePtr)
+	}()
+
+	// Fetch time is what remains of the loop after encoding and writing, both timed on
+	// sampled rows
+	fetchStart := time.Now()
+	var encode, write phaseSampler
+	for src.Next() {
+		sample := rowCount%phaseSampleRate == 0
+		var mark time.Time
+		if sample {
+			mark = time.Now()
 		}
-		if cap(scanArgs) < len(cols) {
-			scanArgs = make([]interface{}, len(cols))
+		if segment != nil {
+			// Direct output encodes straight into the SOL's segment
+			before := len(*segment)
+			*segment = src.AppendRow(tmpl.Encoder, *segment)
+			totalBytes += int64(len(*segment) - before)
+			if sample {
+				encode.add(time.Since(mark))
+			}
 		} else {
-			scanArgs = scanArgs[:len(cols)]
-		}
-		
-		for i := range values {
-			scanArgs[i] = &values[i]
-		}
-		if err := rows.Scan(scanArgs...); err != nil {
-			// Return objects to pools before error return
-			valuesPool.Put(values[:0])
-			scanArgsPool.Put(scanArgs[:0])
-			return err
-		}
-		
-		var strValues []string
-		for _, v := range values {
-			if v.Valid {
-				strValues = append(strValues, v.String)
-			} else {
-				strValues = append(strValues, "")
+			line = src.AppendRow(tmpl.Encoder, line[:0])
+			if sample {
+				encoded := time.Now()
+				encode.add(encoded.Sub(mark))
+				mark = encoded
+			}
+			buf.Write(line)
+			if sample {
+				write.add(time.Since(mark))
 			}
+			totalBytes += int64(len(line))
 		}
-		
-		formattedRow := formatRow(cfg, cols, strValues) + "\n"
-		buf.WriteString(formattedRow)
-		
 		rowCount++
-		totalBytes += int64(len(formattedRow))
-		
-		// Return objects to pools for reuse
-		valuesPool.Put(values[:0])
-		scanArgsPool.Put(scanArgs[:0])
 	}
-	
+	if err := src.Err(); err != nil {
+		return err
+	}
+	encodeTime, writeTime := encode.total(rowCount), write.total(rowCount)
+	fetchTime := max(time.Since(fetchStart)-encodeTime-writeTime, 0)
+	if buf != nil {
+		flushStart := time.Now()
+		if err := buf.Flush(); err != nil {
+			return fmt.Errorf("failed to write spool file: %w", err)
+		}
+		writeTime += time.Since(flushStart)
+		globalMetrics.RecordPhase(procName, PhaseWrite, writeTime)
+	}
+	globalMetrics.RecordPhase(procName, PhaseFetch, fetchTime)
+	globalMetrics.RecordPhase(procName, PhaseEncode, encodeTime)
+
 	// Record performance metrics
 	queryDuration := time.Since(start)
 	globalMetrics.RecordQuery(queryDuration, rowCount, totalBytes)
+	globalMetrics.RecordEstimatedRoundTrips(estimateRoundTrips(rowCount, tmpl.PrefetchCount, tmpl.FetchArraySize))
 	
 	return nil
 }
@@ -246,54 +290,73 @@ func mergeFiles(cfg *ExtractionConfig) error {
 			slog.Info("Skipping merge for chunked procedure", "procedure", proc, "reason", "files already in final format")
 			continue
 		}
+		if err := mergeProcedureFiles(cfg, proc); err != nil {
+			return err
+		}
+	}
+	return nil
+}
 
-		slog.Info("Starting merge for procedure", "procedure", proc)
+// mergeProcedureFiles concatenates a procedure's spool files, in SOL order, into <proc>.txt
+func mergeProcedureFiles(cfg *ExtractionConfig, proc string) error {
+	slog.Info("Starting merge for procedure", "procedure", proc)
 
-		pattern := filepath.Join(cfg.SpoolOutputPath, fmt.Sprintf("%s_*.spool", proc))
-		finalFile := filepath.Join(cfg.SpoolOutputPath, fmt.Sprintf("%s.txt", proc))
+	pattern := filepath.Join(cfg.SpoolOutputPath, fmt.Sprintf("%s_*.spool", proc))
+	finalFile := filepath.Join(cfg.SpoolOutputPath, fmt.Sprintf("%s.txt", proc))
 
-		files, err := filepath.Glob(pattern)
-		if err != nil {
-			return fmt.Errorf("glob failed: %w", err)
-		}
-		slices.Sort(files)
+	files, err := filepath.Glob(pattern)
+	if err != nil {
+		return fmt.Errorf("glob failed: %w", err)
+	}
+	slices.Sort(files)
+
+	out, err := createOutputFile(finalFile, cfg)
+	if err != nil {
+		return err
+	}
+	start := time.Now()
 
-		outFile, err := os.Create(finalFile)
+	for _, file := range files {
+		in, err := os.Open(file)
 		if err != nil {
+			out.Close()
 			return err
 		}
-		defer outFile.Close()
-
-		// Use larger buffer for merge operations (256KB)
-		writer := bufio.NewWriterSize(outFile, 256*1024)
-		start := time.Now()
-
-		for _, file := range files {
-			in, err := os.Open(file)
-			if err != nil {
-				return err
-			}
-			// Use larger scanner buffer for reading (128KB)
-			scanner := bufio.NewScanner(in)
-			scanBuf := make([]byte, 0, 128*1024)
-			scanner.Buffer(scanBuf, 1024*1024) // Max 1MB per line
-			
-			for scanner.Scan() {
-				writer.WriteString(scanner.Text() + "\n")
-			}
-			in.Close()
-			os.Remove(file)
+		// Spool files are already newline-terminated lines, so copy them byte for byte
+		_, err = out.ReadFrom(in)
+		in.Close()
+		if err != nil {
+			out.Close()
+			return fmt.Errorf("failed to merge %s: %w", file, err)
 		}
-		writer.Flush()
-		slog.Info("Merge completed", 
-			"procedure", proc,
-			"file_count", len(files), 
-			"output_file", finalFile, 
-			"duration", time.Since(start).Round(time.Second).String())
+		os.Remove(file)
 	}
+	if err := out.Close(); err != nil {
+		return err
+	}
+	slog.Info("Merge completed", 
+		"procedure", proc,
+		"file_count", len(files), 
+		"output_file", out.Path, 
+		"duration", time.Since(start).Round(time.Second).String())
 	return nil
 }
 
+// loadTemplate reads a procedure's column template and compiles its row encoder
+func loadTemplate(path string, cfg *ExtractionConfig) (*Template, error) {
+	cols, err := readColumnsFromCSV(path)
+	if err != nil {
+		return nil, err
+	}
+	fetchArraySize, prefetchCount := fetchSizes(cols, cfg)
+	return &Template{
+		Columns:        cols,
+		Encoder:        NewRowEncoder(cols, cfg.Format, cfg.Delimiter),
+		FetchArraySize: fetchArraySize,
+		PrefetchCount:  prefetchCount,
+	}, nil
+}
+
 func readColumnsFromCSV(path string) ([]ColumnConfig, error) {
 	f, err := os.Open(path)
 	if err != nil {
@@ -328,54 +391,3 @@ func readColumnsFromCSV(path string) ([]ColumnConfig, error) {
 	}
 	return cols, nil
 }
-
-func sanitize(s string) string {
-	return strings.ReplaceAll(strings.ReplaceAll(s, "\n", " "), "\r", " ")
-}
-
-func formatRow(cfg *ExtractionConfig, cols []ColumnConfig, values []string) string {
-	switch cfg.Format {
-	case "delimited":
-		// Use string builder from pool for better performance
-		builder := stringBuilderPool.Get().(*strings.Builder)
-		builder.Reset()
-		defer stringBuilderPool.Put(builder)
-		
-		for i, v := range values {
-			if i > 0 {
-				builder.WriteString(cfg.Delimiter)
-			}
-			builder.WriteString(sanitize(v))
-		}
-		return builder.String()
-
-	case "fixed":
-		// Use string builder from pool for better performance
-		builder := stringBuilderPool.Get().(*strings.Builder)
-		builder.Reset()
-		defer stringBuilderPool.Put(builder)
-		
-		for i, col := range cols {
-			var val string
-			if i < len(values) && values[i] != "" {
-				val = sanitize(values[i])
-			} else {
-				val = ""
-			}
-
-			if len(val) > col.Length {
-				val = val[:col.Length]
-			}
-
-			if col.Align == "right" {
-				builder.WriteString(fmt.Sprintf("%*s", col.Length, val))
-			} else {
-				builder.WriteString(fmt.Sprintf("%-*s", col.Length, val))
-			}
-		}
-		return builder.String()
-
-	default:
-		return ""
-	}
-}
@@ -0,0 +1,240 @@
+package main
+
+import (
+	"bytes"
+	"context"
+	"database/sql"
+	"errors"
+	"fmt"
+	"log/slog"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/godror/godror"
+)
+
+// Fetch array bounds when sizing from the template row width
+const (
+	minFetchArraySize = 100
+	maxFetchArraySize = 10000
+)
+
+// fetchSizes picks godror's FetchArraySize and PrefetchCount for a template. Unless set
+// explicitly, the fetch array is sized so one round trip carries about FetchBufferKB of rows.
+func fetchSizes(cols []ColumnConfig, cfg *ExtractionConfig) (int, int) {
+	fetchArraySize := cfg.FetchArraySize
+	if fetchArraySize <= 0 {
+		rowWidth := 0
+		for _, col := range cols {
+			rowWidth += max(col.Length, 1)
+		}
+		fetchArraySize = cfg.FetchBufferKB * 1024 / max(rowWidth, 1)
+		fetchArraySize = min(max(fetchArraySize, minFetchArraySize), maxFetchArraySize)
+	}
+	prefetchCount := cfg.PrefetchCount
+	if prefetchCount <= 0 {
+		prefetchCount = fetchArraySize
+	}
+	return fetchArraySize, prefetchCount
+}
+
+// estimateRoundTrips estimates the round trips of a query from its configured sizes: the
+// execute carries the prefetched rows and every further FetchArraySize rows costs one fetch
+func estimateRoundTrips(rows int64, prefetchCount, fetchArraySize int) int64 {
+	remaining := rows - int64(prefetchCount)
+	if remaining < 0 {
+		return 1
+	}
+	return 1 + (remaining+int64(fetchArraySize))/int64(fetchArraySize)
+}
+
+// extractProcedureForBatch extracts one procedure for a batch of SOLs and logs every SOL
+// separately. If the set-based query fails, the batch is retried one SOL at a time so
+// each SOL still gets its own exact outcome.
+func extractProcedureForBatch(ctx context.Context, db *sql.DB, proc string, solIDs []string, firstSeq int, cfg *ExtractionConfig, templates map[string]*Template, out *ProcOutput, logCh chan<- ProcLog, summary *ProcSummaries) {
+	slog.Debug("Starting batch extraction", "procedure", proc, "sol_count", len(solIDs), "first_sol_id", solIDs[0])
+	start := time.Now()
+	segments := make([]*[]byte, len(solIDs))
+	for i := range segments {
+		segments[i] = getSegment()
+	}
+
+	err := extractDataBatch(ctx, db, proc, solIDs, cfg, templates, segments)
+	end := time.Now()
+	if err != nil {
+		// Falling back is only visible as slowness, so the first one per procedure is a warning
+		level := slog.LevelDebug
+		if _, warned := batchFallbackWarned.LoadOrStore(proc, true); !warned {
+			level = slog.LevelWarn
+		}
+		if errors.Is(err, errUnmatchedSolID) {
+			slog.Log(ctx, level, "Batch query rows do not match the SOL list, retrying one SOL at a time; check the SOL_ID column type",
+				"procedure", proc,
+				"sol_count", len(solIDs),
+				"error", err)
+		} else {
+			slog.Log(ctx, level, "Batch extraction failed, retrying one SOL at a time",
+				"procedure", proc,
+				"sol_count", len(solIDs),
+				"first_sol_id", solIDs[0],
+				"error", err)
+		}
+		for _, segment := range segments {
+			putSegment(segment)
+		}
+		for i, solID := range solIDs {
+			solStart := time.Now()
+			err := extractData(ctx, db, proc, solID, cfg, templates, out, firstSeq+i)
+			recordExtraction(logCh, summary, solID, proc, solStart, time.Now(), err)
+		}
+		return
+	}
+
+	for i, solID := range solIDs {
+		var err error
+		writeStart := time.Now()
+		if out != nil {
+			out.Commit(firstSeq+i, segments[i])
+		} else {
+			err = writeSpoolSegment(cfg, proc, solID, segments[i])
+		}
+		globalMetrics.RecordPhase(proc, PhaseWrite, time.Since(writeStart))
+		recordExtraction(logCh, summary, solID, proc, start, end, err)
+	}
+	slog.Debug("Completed batch extraction",
+		"procedure", proc,
+		"sol_count", len(solIDs),
+		"duration", end.Sub(start).Round(time.Millisecond).String())
+}
+
+// errUnmatchedSolID means a batch query returned a SOL_ID that is not in the batch
+var errUnmatchedSolID = errors.New("batch query returned unexpected SOL_ID")
+
+// batchFallbackWarned holds the procedures whose batch extraction has fallen back to
+// per-SOL queries at least once
+var batchFallbackWarned sync.Map
+
+// batchQuery builds the set-based query for a procedure. The IN list always has batchSize
+// binds, so a single prepared statement serves every batch including the last, short one.
+func batchQuery(procName string, cols []ColumnConfig, batchSize int) string {
+	colNames := make([]string, len(cols))
+	for i, col := range cols {
+		colNames[i] = col.Name
+	}
+	binds := make([]string, batchSize)
+	for i := range binds {
+		binds[i] = fmt.Sprintf(":%d", i+1)
+	}
+	return fmt.Sprintf("SELECT SOL_ID, %s FROM %s WHERE SOL_ID IN (%s) ORDER BY SOL_ID",
+		strings.Join(colNames, ", "), procName, strings.Join(binds, ", "))
+}
+
+// extractDataBatch runs the set-based query for a batch of SOLs and splits the result,
+// ordered by SOL_ID, back into one encoded segment per SOL. Nothing is written on error.
+func extractDataBatch(ctx context.Context, db *sql.DB, procName string, solIDs []string, cfg *ExtractionConfig, templates map[string]*Template, segments []*[]byte) error {
+	tmpl, ok := templates[procName]
+	if !ok {
+		return fmt.Errorf("missing template for procedure %s", procName)
+	}
+	cols := tmpl.Columns
+
+	query := batchQuery(procName, cols, cfg.SolBatchSize)
+	start := time.Now()
+
+	stmt, err := globalStmtCache.GetOrPrepare(db, query)
+	if err != nil {
+		return fmt.Errorf("failed to prepare statement: %w", err)
+	}
+	globalMetrics.RecordPhase(procName, PhasePrepare, time.Since(start))
+
+	// Pad a short batch by repeating its last SOL; duplicates in the IN list are harmless
+	args := make([]interface{}, 0, cfg.SolBatchSize+2)
+	args = append(args,
+		godror.FetchArraySize(tmpl.FetchArraySize),
+		godror.PrefetchCount(tmpl.PrefetchCount))
+	for i := range cfg.SolBatchSize {
+		args = append(args, solIDs[min(i, len(solIDs)-1)])
+	}
+
+	execStart := time.Now()
+	rows, err := stmt.QueryContext(ctx, args...)
+	if err != nil {
+		return fmt.Errorf("batch query failed: %w", err)
+	}
+	defer rows.Close()
+	globalMetrics.RecordPhase(procName, PhaseExecute, time.Since(execStart))
+	slog.Debug("Batch query executed",
+		"procedure", procName,
+		"sol_count", len(solIDs),
+		"duration", time.Since(start).Round(time.Millisecond).String())
+
+	// SOL_IDs are matched without surrounding blanks, as a CHAR column returns them padded
+	solIndex := make(map[string]int, len(solIDs))
+	for i, solID := range solIDs {
+		solIndex[strings.TrimSpace(solID)] = i
+	}
+
+	// Column 0 is SOL_ID; the template columns follow
+	values := make([]sql.RawBytes, len(cols)+1)
+	scanArgs := make([]interface{}, len(values))
+	for i := range values {
+		scanArgs[i] = &values[i]
+	}
+
+	rowCount := int64(0)
+	totalBytes := int64(0)
+	current := -1
+	var currentID []byte
+	// Encoding is timed on sampled rows; fetch time is what remains of the loop
+	fetchStart := time.Now()
+	var encode phaseSampler
+	for rows.Next() {
+		if err := rows.Scan(scanArgs...); err != nil {
+			return err
+		}
+
+		// Rows arrive grouped by SOL_ID, so only look the SOL up when it changes
+		if current < 0 || !bytes.Equal(values[0], currentID) {
+			i, ok := solIndex[string(bytes.TrimSpace(values[0]))]
+			if !ok {
+				return fmt.Errorf("%w %q", errUnmatchedSolID, values[0])
+			}
+			current = i
+			currentID = append(currentID[:0], values[0]...)
+		}
+
+		sample := rowCount%phaseSampleRate == 0
+		var encodeStart time.Time
+		if sample {
+			encodeStart = time.Now()
+		}
+		segment := segments[current]
+		before := len(*segment)
+		*segment = tmpl.Encoder.AppendRow(*segment, values[1:])
+		totalBytes += int64(len(*segment) - before)
+		if sample {
+			encode.add(time.Since(encodeStart))
+		}
+		rowCount++
+	}
+	if err := rows.Err(); err != nil {
+		return err
+	}
+	encodeTime := encode.total(rowCount)
+	globalMetrics.RecordPhase(procName, PhaseFetch, max(time.Since(fetchStart)-encodeTime, 0))
+	globalMetrics.RecordPhase(procName, PhaseEncode, encodeTime)
+
+	globalMetrics.RecordQuery(time.Since(start), rowCount, totalBytes)
+	globalMetrics.RecordEstimatedRoundTrips(estimateRoundTrips(rowCount, tmpl.PrefetchCount, tmpl.FetchArraySize))
+	return nil
+}
+
+// writeSpoolSegment writes one SOL's encoded rows to its spool file for the end-of-run merge
+func writeSpoolSegment(cfg *ExtractionConfig, procName, solID string, segment *[]byte) error {
+	defer putSegment(segment)
+	spoolPath := filepath.Join(cfg.SpoolOutputPath, fmt.Sprintf("%s_%s.spool", procName, solID))
+	return os.WriteFile(spoolPath, *segment, 0o644)
+}
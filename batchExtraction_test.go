@@ -0,0 +1,70 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"testing"
+)
+
+func TestBatchQuery(t *testing.T) {
+	cols := []ColumnConfig{{Name: "ACCT_NO"}, {Name: "BALANCE"}}
+	got := batchQuery("P_ACCTS", cols, 4)
+	want := "SELECT SOL_ID, ACCT_NO, BALANCE FROM P_ACCTS WHERE SOL_ID IN (:1, :2, :3, :4) ORDER BY SOL_ID"
+	if got != want {
+		t.Errorf("batchQuery =\n%s\nwant\n%s", got, want)
+	}
+}
+
+// runTestBatch extracts solIDs in one batch of batchSize from the synthetic profile and
+// checks every SOL's segment against that SOL's generated rows
+func runTestBatch(t *testing.T, profile SyntheticProcedure, batchSize int, solIDs []string) {
+	t.Helper()
+	const proc = "P_BATCH"
+	setSyntheticDB(SyntheticDB{Procedures: map[string]SyntheticProcedure{proc: profile}})
+	db, err := sql.Open(syntheticDriverName, "")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+	defer globalStmtCache.Close()
+
+	cols := syntheticColumns(profile)
+	cfg := &ExtractionConfig{Format: "fixed", SolBatchSize: batchSize, FetchBufferKB: 512}
+	fetchArraySize, prefetchCount := fetchSizes(cols, cfg)
+	tmpl := &Template{Columns: cols, Encoder: NewRowEncoder(cols, cfg.Format, ""), FetchArraySize: fetchArraySize, PrefetchCount: prefetchCount}
+	templates := map[string]*Template{proc: tmpl}
+
+	segments := make([]*[]byte, len(solIDs))
+	for i := range segments {
+		segments[i] = new([]byte)
+	}
+	if err := extractDataBatch(context.Background(), db, proc, solIDs, cfg, templates, segments); err != nil {
+		t.Fatal(err)
+	}
+
+	generated := syntheticCurrent.Load().procedure(proc)
+	for i, solID := range solIDs {
+		var want []byte
+		for r := range generated.rowCount(solID) {
+			want = tmpl.Encoder.AppendValues(want, generated.values[r%syntheticValueRows])
+		}
+		if string(*segments[i]) != string(want) {
+			t.Errorf("segment %d (%s) has %d bytes, want the SOL's %d rows in %d bytes",
+				i, solID, len(*segments[i]), generated.rowCount(solID), len(want))
+		}
+	}
+}
+
+func TestExtractDataBatchPaddingAndOrdering(t *testing.T) {
+	profile := SyntheticProcedure{RowsMin: 0, RowsMax: 6, Columns: 5}
+	// A short batch is padded by repeating its last SOL, and rows come back ordered by
+	// SOL_ID, not in the batch's order; each must still land in its own SOL's segment
+	runTestBatch(t, profile, 8, []string{"SOL0000009", "SOL0000002", "SOL0000005"})
+	runTestBatch(t, profile, 3, []string{"SOL0000003", "SOL0000001", "SOL0000002"})
+}
+
+func TestExtractDataBatchCharPaddedSolID(t *testing.T) {
+	// A CHAR(16) SOL_ID column returns blank-padded values
+	profile := SyntheticProcedure{RowsMin: 1, RowsMax: 4, Columns: 3, SolIDWidth: 16}
+	runTestBatch(t, profile, 4, []string{"SOL0000004", "SOL0000001"})
+}
@@ -0,0 +1,157 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"errors"
+	"fmt"
+	"strings"
+	"sync"
+	"time"
+)
+
+// Batch call statuses returned through the OUT array
+const (
+	batchStatusFail          = 0
+	batchStatusSuccess       = 1
+	batchStatusFailCommitted = 2 // failed, and the savepoint was gone so its partial work stays committed
+)
+
+// errPartialCommit marks a failed SOL whose procedure committed part of its work before
+// failing. A COMMIT inside the procedure erases the savepoint, so the failure could not be
+// rolled back and the SOL must not simply be rerun.
+var errPartialCommit = errors.New("procedure failed after committing part of its work")
+
+// errBatchNotRun marks a batch call that failed before its block ran on the server, so
+// none of its SOLs was called and they can safely be retried one at a time. Any later
+// failure leaves the outcome unknown: a procedure may have committed part of the batch
+// itself, or the call may have completed before the error reached the client.
+var errBatchNotRun = errors.New("batch call did not run")
+
+// batchCallBlock wraps one procedure call so that executeMany runs it once per SOL and
+// reports each SOL's outcome through the OUT arrays instead of aborting the batch. The
+// savepoint undoes a failed SOL's partial work, as the single call's rollback would;
+// if the procedure committed internally the rollback fails and the SOL is reported as
+// batchStatusFailCommitted.
+func batchCallBlock(pkgName, procName string) string {
+	return fmt.Sprintf(`BEGIN
+  SAVEPOINT sol_call;
+  %s.%s(:1);
+  :2 := %d;
+  :3 := NULL;
+EXCEPTION
+  WHEN OTHERS THEN
+    :3 := DBMS_UTILITY.FORMAT_ERROR_STACK;
+    BEGIN
+      ROLLBACK TO SAVEPOINT sol_call;
+      :2 := %d;
+    EXCEPTION
+      WHEN OTHERS THEN
+        :2 := %d;
+    END;
+END;`, pkgName, procName, batchStatusSuccess, batchStatusFail, batchStatusFailCommitted)
+}
+
+// callProcedureBatch calls a procedure for every SOL in one round trip using array binds.
+// It returns one error per SOL (nil on success). If the call itself fails the error is
+// returned instead; it wraps errBatchNotRun only if the block never ran, and otherwise
+// every SOL's outcome is unknown even though the transaction is rolled back.
+func callProcedureBatch(ctx context.Context, db *sql.DB, pkgName, procName string, solIDs []string) ([]error, error) {
+	// godror only uses executeMany for arrays of two or more
+	if len(solIDs) == 1 {
+		return []error{callProcedure(ctx, db, pkgName, procName, solIDs[0])}, nil
+	}
+
+	query := batchCallBlock(pkgName, procName)
+	start := time.Now()
+	stmt, err := procStmtCache.GetOrPrepare(db, query)
+	if err != nil {
+		return nil, fmt.Errorf("%w: failed to prepare batch procedure statement: %w", errBatchNotRun, err)
+	}
+	globalMetrics.RecordPhase(procName, PhasePrepare, time.Since(start))
+
+	// One transaction per batch, so a failed call leaves nothing behind to retry over
+	tx, err := db.BeginTx(ctx, nil)
+	if err != nil {
+		return nil, fmt.Errorf("%w: failed to begin batch transaction: %w", errBatchNotRun, err)
+	}
+	// godror gives every OUT VARCHAR element a 32767 byte buffer, so the error texts cost
+	// 32KB per SOL for the duration of the call; setInsertBatchDefaults caps the batch size
+	statuses := make([]int64, len(solIDs))
+	errTexts := make([]string, len(solIDs))
+	execStart := time.Now()
+	_, err = tx.StmtContext(ctx, stmt).ExecContext(ctx,
+		solIDs,
+		sql.Out{Dest: &statuses},
+		sql.Out{Dest: &errTexts})
+	globalMetrics.RecordPhase(procName, PhaseExecute, time.Since(execStart))
+	if err != nil {
+		tx.Rollback()
+		return nil, fmt.Errorf("batch procedure call failed: %w", err)
+	}
+	if err := tx.Commit(); err != nil {
+		return nil, fmt.Errorf("failed to commit batch: %w", err)
+	}
+
+	results := make([]error, len(solIDs))
+	for i := range solIDs {
+		if statuses[i] == batchStatusSuccess {
+			continue
+		}
+		errText := strings.TrimSpace(errTexts[i])
+		if errText == "" {
+			errText = "procedure reported no status"
+		}
+		if statuses[i] == batchStatusFailCommitted {
+			results[i] = fmt.Errorf("%w: %s", errPartialCommit, errText)
+			continue
+		}
+		results[i] = errors.New(errText)
+	}
+	return results, nil
+}
+
+// batchShare returns the start and end logged for SOL i of a batch call of n SOLs. Each
+// SOL gets an equal share of the call, so the run log's durations, which weight the next
+// run's scheduling, stay per SOL rather than per batch.
+func batchShare(start, end time.Time, i, n int) (time.Time, time.Time) {
+	per := end.Sub(start) / time.Duration(n)
+	solStart := start.Add(per * time.Duration(i))
+	return solStart, solStart.Add(per)
+}
+
+// BatchSizer adapts a procedure's batch size to observed call latency: the size doubles
+// while full batches finish well under the target and halves when a call overshoots it.
+type BatchSizer struct {
+	mu      sync.Mutex
+	size    int
+	maxSize int
+	target  time.Duration
+}
+
+func NewBatchSizer(initial, maxSize int, target time.Duration) *BatchSizer {
+	return &BatchSizer{
+		size:    min(max(initial, 1), maxSize),
+		maxSize: maxSize,
+		target:  target,
+	}
+}
+
+// Size returns the batch size to use for the next call
+func (b *BatchSizer) Size() int {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	return b.size
+}
+
+// Observe feeds back the latency of a call made with batchLen SOLs
+func (b *BatchSizer) Observe(batchLen int, elapsed time.Duration) {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	switch {
+	case elapsed > b.target:
+		b.size = max(b.size/2, 1)
+	case elapsed < b.target/2 && batchLen >= b.size:
+		b.size = min(b.size*2, b.maxSize)
+	}
+}
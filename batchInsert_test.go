@@ -0,0 +1,248 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"errors"
+	"fmt"
+	"testing"
+	"time"
+)
+
+// testSols returns n SOL IDs
+func testSols(n int) []string {
+	sols := make([]string, n)
+	for i := range sols {
+		sols[i] = fmt.Sprintf("SOL-%04d", i+1)
+	}
+	return sols
+}
+
+// openBatchTestDB sets the synthetic profile of proc and opens the synthetic database.
+// Each test uses its own procedure name, since procStmtCache keeps the compiled profile
+// of every statement it has prepared.
+func openBatchTestDB(t *testing.T, proc string, profile SyntheticProcedure) *sql.DB {
+	t.Helper()
+	setSyntheticDB(SyntheticDB{Procedures: map[string]SyntheticProcedure{proc: profile}})
+	db, err := sql.Open(syntheticDriverName, "")
+	if err != nil {
+		t.Fatal(err)
+	}
+	t.Cleanup(func() {
+		procStmtCache.Close()
+		db.Close()
+	})
+	return db
+}
+
+func TestCallProcedureBatchAllSucceed(t *testing.T) {
+	const proc = "P_BATCH_OK"
+	db := openBatchTestDB(t, proc, SyntheticProcedure{})
+	sols := testSols(20)
+
+	results, err := callProcedureBatch(context.Background(), db, "PKG", proc, sols)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(results) != len(sols) {
+		t.Fatalf("%d results for %d SOLs", len(results), len(sols))
+	}
+	for i, err := range results {
+		if err != nil {
+			t.Errorf("SOL %s: %v", sols[i], err)
+		}
+	}
+}
+
+func TestCallProcedureBatchStatuses(t *testing.T) {
+	const proc = "P_BATCH_MIXED"
+	db := openBatchTestDB(t, proc, SyntheticProcedure{FailureRate: 0.4, CommitRate: 0.5})
+	sols := testSols(60)
+
+	results, err := callProcedureBatch(context.Background(), db, "PKG", proc, sols)
+	if err != nil {
+		t.Fatal(err)
+	}
+	generated := syntheticCurrent.Load().procedure(proc)
+	var succeeded, failed, committed int
+	for i, solID := range sols {
+		want := generated.failure(solID)
+		got := results[i]
+		switch {
+		case want == nil:
+			succeeded++
+			if got != nil {
+				t.Errorf("SOL %s: unexpected error %v", solID, got)
+			}
+		case got == nil:
+			t.Errorf("SOL %s: no error, want %q", solID, want)
+		case generated.committed(solID):
+			committed++
+			if !errors.Is(got, errPartialCommit) {
+				t.Errorf("SOL %s: %v does not mark a partial commit", solID, got)
+			}
+			if got.Error() != fmt.Sprintf("%v: %v", errPartialCommit, want) {
+				t.Errorf("SOL %s: error %q does not carry the procedure's %q", solID, got, want)
+			}
+		default:
+			failed++
+			if errors.Is(got, errPartialCommit) {
+				t.Errorf("SOL %s: rolled back failure %v marked as a partial commit", solID, got)
+			}
+			if got.Error() != want.Error() {
+				t.Errorf("SOL %s: error %q, want %q", solID, got, want)
+			}
+		}
+	}
+	// The hash spreads these SOLs over all three outcomes; if it ever stops, widen the batch
+	if succeeded == 0 || failed == 0 || committed == 0 {
+		t.Fatalf("%d succeeded, %d failed, %d failed committed: the batch does not cover every status",
+			succeeded, failed, committed)
+	}
+}
+
+func TestCallProcedureBatchErrors(t *testing.T) {
+	tests := []struct {
+		failure string
+		notRun  bool
+	}{
+		{failure: "prepare", notRun: true},
+		{failure: "execute", notRun: false},
+	}
+	for _, tt := range tests {
+		t.Run(tt.failure, func(t *testing.T) {
+			proc := "P_BATCH_ERR_" + tt.failure
+			db := openBatchTestDB(t, proc, SyntheticProcedure{BatchFailure: tt.failure})
+
+			results, err := callProcedureBatch(context.Background(), db, "PKG", proc, testSols(8))
+			if err == nil {
+				t.Fatalf("no error, results %v", results)
+			}
+			if results != nil {
+				t.Errorf("results %v returned with the batch error", results)
+			}
+			if got := errors.Is(err, errBatchNotRun); got != tt.notRun {
+				t.Errorf("errors.Is(%v, errBatchNotRun) = %v, want %v", err, got, tt.notRun)
+			}
+		})
+	}
+}
+
+// runBatchedInsert runs the insert mode's batched calls for sols and returns each SOL's
+// log record
+func runBatchedInsert(t *testing.T, proc string, sols []string) map[string]ProcLog {
+	t.Helper()
+	cfg := &ExtractionConfig{
+		PackageName:         "PKG",
+		Procedures:          []string{proc},
+		InsertBatchSize:     4,
+		InsertBatchMaxSize:  8,
+		InsertBatchTargetMs: 1000,
+	}
+	db, err := sql.Open(syntheticDriverName, "")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+
+	logCh := make(chan ProcLog, len(sols))
+	limiter := NewAIMDLimiter(2, 1, 2, nil)
+	runProceduresWithProcLevelParallelism(context.Background(), db, sols, cfg, logCh,
+		NewProcSummaries(cfg.Procedures), limiter, 2, nil)
+	close(logCh)
+
+	logs := make(map[string]ProcLog, len(sols))
+	for plog := range logCh {
+		if _, dup := logs[plog.SolID]; dup {
+			t.Errorf("SOL %s logged twice", plog.SolID)
+		}
+		logs[plog.SolID] = plog
+	}
+	if len(logs) != len(sols) {
+		t.Fatalf("%d SOLs logged, want %d", len(logs), len(sols))
+	}
+	return logs
+}
+
+func TestBatchedInsertFallsBackWhenBatchNotRun(t *testing.T) {
+	const proc = "P_BATCH_FALLBACK"
+	openBatchTestDB(t, proc, SyntheticProcedure{FailureRate: 0.3, BatchFailure: "prepare"})
+	sols := testSols(20)
+
+	logs := runBatchedInsert(t, proc, sols)
+	generated := syntheticCurrent.Load().procedure(proc)
+	for _, solID := range sols {
+		want := "SUCCESS"
+		if generated.failure(solID) != nil {
+			want = "FAIL"
+		}
+		if got := logs[solID].Status; got != want {
+			t.Errorf("SOL %s: status %s after the single call retry, want %s (%s)",
+				solID, got, want, logs[solID].ErrorDetails)
+		}
+	}
+}
+
+func TestBatchedInsertFailsSolsWhenBatchOutcomeUnknown(t *testing.T) {
+	const proc = "P_BATCH_UNKNOWN"
+	openBatchTestDB(t, proc, SyntheticProcedure{BatchFailure: "execute"})
+	sols := testSols(20)
+
+	logs := runBatchedInsert(t, proc, sols)
+	for _, solID := range sols {
+		// A retry would succeed, since single calls of this profile never fail
+		if got := logs[solID].Status; got != "FAIL" {
+			t.Errorf("SOL %s: status %s, want FAIL without a retry", solID, got)
+		}
+	}
+}
+
+func TestBatchShareSplitsCall(t *testing.T) {
+	start := time.Date(2025, 1, 1, 0, 0, 0, 0, time.UTC)
+	end := start.Add(400 * time.Millisecond)
+	prevEnd := start
+	for i := range 4 {
+		solStart, solEnd := batchShare(start, end, i, 4)
+		if !solStart.Equal(prevEnd) || solEnd.Sub(solStart) != 100*time.Millisecond {
+			t.Errorf("share %d is %v to %v, want 100ms from %v", i, solStart, solEnd, prevEnd)
+		}
+		prevEnd = solEnd
+	}
+}
+
+func TestBatchSizer(t *testing.T) {
+	const target = 100 * time.Millisecond
+	fast, ok, slow := 10*time.Millisecond, 70*time.Millisecond, 150*time.Millisecond
+
+	if got := NewBatchSizer(0, 16, target).Size(); got != 1 {
+		t.Errorf("initial size 0 starts at %d, want 1", got)
+	}
+	if got := NewBatchSizer(64, 16, target).Size(); got != 16 {
+		t.Errorf("initial size 64 with max 16 starts at %d, want 16", got)
+	}
+
+	b := NewBatchSizer(4, 16, target)
+	steps := []struct {
+		batchLen int
+		elapsed  time.Duration
+		want     int
+	}{
+		{4, fast, 8},   // a full batch well under target doubles
+		{4, fast, 8},   // a short batch, e.g. the SOL list's tail, says nothing about the size
+		{8, ok, 8},     // between half the target and the target holds
+		{8, fast, 16},  // doubles up to the max
+		{16, fast, 16}, // and stays there
+		{16, slow, 8},  // over target halves
+		{8, slow, 4},
+		{4, slow, 2},
+		{2, slow, 1},
+		{1, slow, 1}, // never below one SOL
+		{1, fast, 2},
+	}
+	for i, step := range steps {
+		b.Observe(step.batchLen, step.elapsed)
+		if got := b.Size(); got != step.want {
+			t.Fatalf("step %d: %d SOLs in %v leaves size %d, want %d", i, step.batchLen, step.elapsed, got, step.want)
+		}
+	}
+}
@@ -0,0 +1,290 @@
+package main
+
+import (
+	"bufio"
+	"database/sql"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"log/slog"
+	"os"
+	"path/filepath"
+	"runtime"
+	"slices"
+	"testing"
+	"time"
+)
+
+// The end-to-end benchmark generates a SOL list and templates, runs extract and insert
+// mode in process against the synthetic database and writes one JSON result per mode,
+// so runs can be compared before and after a change:
+//
+//	go test -run TestEndToEndBenchmark -args -benchCfg <file>
+var benchCfgFile = flag.String("benchCfg", "", "Path to an end-to-end benchmark configuration file")
+
+// EndToEndBenchConfig describes an end-to-end benchmark run
+type EndToEndBenchConfig struct {
+	Label          string           `json:"label,omitempty"`           // copied into the results to tell runs apart
+	WorkDir        string           `json:"work_dir,omitempty"`        // generated inputs, outputs and logs; Default: a new temp directory
+	ResultsPath    string           `json:"results_path,omitempty"`    // Default: bench_results.json in work_dir
+	Modes          []string         `json:"modes,omitempty"`           // Default: E then I
+	SolCount       int              `json:"sol_count,omitempty"`       // Default: 1000 generated SOL IDs
+	Concurrency    int              `json:"concurrency,omitempty"`     // Default: 8
+	MaxConnections int              `json:"max_connections,omitempty"` // 0 derives it from concurrency, as in a normal run
+	Run            ExtractionConfig `json:"run"`                       // extraction settings; procedures default to the profiled ones, paths are generated
+	Database       SyntheticDB      `json:"database"`                  // synthetic procedure profiles
+}
+
+// EndToEndBenchResult is the outcome of one mode's run
+type EndToEndBenchResult struct {
+	Mode            string                     `json:"mode"`
+	Sols            int                        `json:"sols"`
+	Procedures      int                        `json:"procedures"`
+	Tasks           int64                      `json:"tasks"` // (SOL, procedure) pairs
+	Calls           int64                      `json:"calls"` // scheduled calls; a SOL batch is one call covering several tasks
+	DurationSeconds float64                    `json:"duration_seconds"`
+	TasksPerSecond  float64                    `json:"tasks_per_second"`
+	Rows            int64                      `json:"rows"`
+	RowsPerSecond   float64                    `json:"rows_per_second"`
+	Bytes           int64                      `json:"bytes"`
+	MBPerSecond     float64                    `json:"mb_per_second"`
+	Allocs          uint64                     `json:"allocs"`
+	AllocsPerRow    float64                    `json:"allocs_per_row,omitempty"`
+	AllocBytes      uint64                     `json:"alloc_bytes"`
+	GCCycles        uint32                     `json:"gc_cycles"`
+	TaskP99Ms       float64                    `json:"task_p99_ms"` // p99 latency of one scheduled call of the slowest procedure
+	ConnWaitCount   int64                      `json:"conn_wait_count"`
+	ConnWaitSeconds float64                    `json:"conn_wait_seconds"`
+	TaskLatency     map[string]LatencySnapshot `json:"task_latency"`
+}
+
+// EndToEndBenchReport is the results file
+type EndToEndBenchReport struct {
+	Label      string                `json:"label,omitempty"`
+	Time       time.Time             `json:"time"`
+	GoVersion  string                `json:"go_version"`
+	NumCPU     int                   `json:"num_cpu"`
+	GOMAXPROCS int                   `json:"gomaxprocs"`
+	Config     EndToEndBenchConfig   `json:"config"`
+	Results    []EndToEndBenchResult `json:"results"`
+}
+
+func loadEndToEndBenchConfig(path string) (EndToEndBenchConfig, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return EndToEndBenchConfig{}, fmt.Errorf("failed to read benchmark config file %s: %w", path, err)
+	}
+
+	var cfg EndToEndBenchConfig
+	if err := json.Unmarshal(data, &cfg); err != nil {
+		return EndToEndBenchConfig{}, fmt.Errorf("failed to parse benchmark config file %s: %w", path, err)
+	}
+	return cfg, nil
+}
+
+// Set default values for the end-to-end benchmark
+func setEndToEndBenchDefaults(config *EndToEndBenchConfig) error {
+	if config.WorkDir == "" {
+		dir, err := os.MkdirTemp("", "claude_extract_bench_")
+		if err != nil {
+			return fmt.Errorf("failed to create benchmark directory: %w", err)
+		}
+		config.WorkDir = dir
+	}
+	if config.ResultsPath == "" {
+		config.ResultsPath = filepath.Join(config.WorkDir, "bench_results.json")
+	}
+	if len(config.Modes) == 0 {
+		config.Modes = []string{"E", "I"}
+	}
+	for _, mode := range config.Modes {
+		if mode != "E" && mode != "I" {
+			return fmt.Errorf("invalid benchmark mode %q, expected E or I", mode)
+		}
+	}
+	if config.SolCount <= 0 {
+		config.SolCount = 1000
+	}
+	if config.Concurrency <= 0 {
+		config.Concurrency = 8
+	}
+	if len(config.Run.Procedures) == 0 {
+		for proc := range config.Database.Procedures {
+			config.Run.Procedures = append(config.Run.Procedures, proc)
+		}
+		slices.Sort(config.Run.Procedures)
+	}
+	if len(config.Run.Procedures) == 0 {
+		return fmt.Errorf("no procedures to benchmark: list run.procedures or database.procedures")
+	}
+	if config.Run.PackageName == "" {
+		config.Run.PackageName = "SYNTHETIC"
+	}
+	if config.Run.Format == "" {
+		config.Run.Format = "fixed"
+	}
+	config.Run.TemplatePath = filepath.Join(config.WorkDir, "templates")
+	return nil
+}
+
+// writeEndToEndInputs writes the SOL list and one template per procedure, shaped like
+// the synthetic rows, and returns the SOL list path
+func writeEndToEndInputs(config *EndToEndBenchConfig) (string, error) {
+	if err := os.MkdirAll(config.Run.TemplatePath, 0o755); err != nil {
+		return "", err
+	}
+	solPath := filepath.Join(config.WorkDir, "sols.txt")
+	f, err := os.Create(solPath)
+	if err != nil {
+		return "", err
+	}
+	w := bufio.NewWriter(f)
+	for i := range config.SolCount {
+		fmt.Fprintf(w, "SOL%07d\n", i+1)
+	}
+	if err := w.Flush(); err != nil {
+		f.Close()
+		return "", err
+	}
+	if err := f.Close(); err != nil {
+		return "", err
+	}
+
+	for _, proc := range config.Run.Procedures {
+		profile, ok := config.Database.Procedures[proc]
+		if !ok {
+			profile = config.Database.Default
+		}
+		var b []byte
+		b = append(b, "name,length,align\n"...)
+		for _, col := range syntheticColumns(profile) {
+			b = fmt.Appendf(b, "%s,%d,%s\n", col.Name, col.Length, col.Align)
+		}
+		if err := os.WriteFile(filepath.Join(config.Run.TemplatePath, proc+".csv"), b, 0o644); err != nil {
+			return "", err
+		}
+	}
+	return solPath, nil
+}
+
+// TestEndToEndBenchmark runs every configured mode against the synthetic database and
+// writes the results file. It is skipped unless -benchCfg is given.
+func TestEndToEndBenchmark(t *testing.T) {
+	if *benchCfgFile == "" {
+		t.Skip("no -benchCfg given")
+	}
+	config, err := loadEndToEndBenchConfig(*benchCfgFile)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := setEndToEndBenchDefaults(&config); err != nil {
+		t.Fatalf("invalid benchmark settings: %v", err)
+	}
+	solPath, err := writeEndToEndInputs(&config)
+	if err != nil {
+		t.Fatalf("failed to write benchmark inputs to %s: %v", config.WorkDir, err)
+	}
+	setSyntheticDB(config.Database)
+	slog.Info("End-to-end benchmark inputs generated",
+		"work_dir", config.WorkDir,
+		"sols", config.SolCount,
+		"procedures", config.Run.Procedures)
+
+	appCfg := MainConfig{
+		Concurrency:    config.Concurrency,
+		MaxConnections: config.MaxConnections,
+		LogFilePath:    filepath.Join(config.WorkDir, "logs"),
+		SolFilePath:    solPath,
+	}
+	report := EndToEndBenchReport{
+		Label:      config.Label,
+		Time:       time.Now(),
+		GoVersion:  runtime.Version(),
+		NumCPU:     runtime.NumCPU(),
+		GOMAXPROCS: runtime.GOMAXPROCS(0),
+		Config:     config,
+	}
+	for _, mode := range config.Modes {
+		runCfg := config.Run
+		runCfg.SpoolOutputPath = filepath.Join(config.WorkDir, "output_"+mode)
+		for _, dir := range []string{appCfg.LogFilePath, runCfg.SpoolOutputPath} {
+			if err := os.MkdirAll(dir, 0o755); err != nil {
+				t.Fatal(err)
+			}
+		}
+		result := runEndToEndMode(t, mode, appCfg, runCfg, config.SolCount)
+		slog.Info("End-to-end benchmark result",
+			"mode", result.Mode,
+			"tasks_per_second", fmt.Sprintf("%.1f", result.TasksPerSecond),
+			"rows_per_second", fmt.Sprintf("%.0f", result.RowsPerSecond),
+			"mb_per_second", fmt.Sprintf("%.2f", result.MBPerSecond),
+			"allocs_per_row", fmt.Sprintf("%.2f", result.AllocsPerRow),
+			"task_p99_ms", fmt.Sprintf("%.2f", result.TaskP99Ms),
+			"conn_wait_seconds", fmt.Sprintf("%.3f", result.ConnWaitSeconds))
+		report.Results = append(report.Results, result)
+	}
+
+	data, err := json.MarshalIndent(report, "", "  ")
+	if err == nil {
+		err = os.WriteFile(config.ResultsPath, data, 0o644)
+	}
+	if err != nil {
+		t.Fatalf("failed to write benchmark results: %v", err)
+	}
+	slog.Info("End-to-end benchmark results written", "path", config.ResultsPath)
+}
+
+// runEndToEndMode runs one mode with fresh metrics and measures it
+func runEndToEndMode(t *testing.T, mode string, appCfg MainConfig, runCfg ExtractionConfig, sols int) EndToEndBenchResult {
+	globalMetrics = NewPerformanceMetrics()
+	runtime.GC()
+	var before, after runtime.MemStats
+	runtime.ReadMemStats(&before)
+	start := time.Now()
+
+	db, err := sql.Open(syntheticDriverName, "")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+	dbStats, err := runMode(mode, db, appCfg, runCfg)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	elapsed := time.Since(start)
+	runtime.ReadMemStats(&after)
+
+	result := EndToEndBenchResult{
+		Mode:            mode,
+		Sols:            sols,
+		Procedures:      len(runCfg.Procedures),
+		Tasks:           int64(sols) * int64(len(runCfg.Procedures)),
+		DurationSeconds: elapsed.Seconds(),
+		Rows:            globalMetrics.RowsProcessed(),
+		Bytes:           globalMetrics.BytesWritten(),
+		Allocs:          after.Mallocs - before.Mallocs,
+		AllocBytes:      after.TotalAlloc - before.TotalAlloc,
+		GCCycles:        after.NumGC - before.NumGC,
+		ConnWaitCount:   dbStats.WaitCount,
+		ConnWaitSeconds: dbStats.WaitDuration.Seconds(),
+		TaskLatency:     make(map[string]LatencySnapshot),
+	}
+	for _, proc := range globalMetrics.Procedures() {
+		stats, ok := globalMetrics.PhaseStats(proc, PhaseTask)
+		if !ok {
+			continue
+		}
+		result.Calls += stats.Count
+		result.TaskLatency[proc] = latencySnapshot(stats)
+		result.TaskP99Ms = max(result.TaskP99Ms, msec(stats.P99))
+	}
+	seconds := elapsed.Seconds()
+	result.TasksPerSecond = float64(result.Tasks) / seconds
+	result.RowsPerSecond = float64(result.Rows) / seconds
+	result.MBPerSecond = float64(result.Bytes) / (1024 * 1024) / seconds
+	if result.Rows > 0 {
+		result.AllocsPerRow = float64(result.Allocs) / float64(result.Rows)
+	}
+	return result
+}
@@ -83,19 +83,26 @@ func (c *Cache[K, V]) GetOrSet(key K, factory func() (V, error)) (V, error) {
 
 // PreparedStmtCache is a specialized cache for SQL prepared statements
 type PreparedStmtCache struct {
-	cache *Cache[string, *sql.Stmt]
+	cache *Cache[stmtKey, *sql.Stmt]
+}
+
+// stmtKey identifies a statement by the pool that prepared it and its query text,
+// as a *sql.Stmt only runs on the *sql.DB it was prepared on
+type stmtKey struct {
+	db    *sql.DB
+	query string
 }
 
 // NewPreparedStmtCache creates a new prepared statement cache
 func NewPreparedStmtCache() *PreparedStmtCache {
 	return &PreparedStmtCache{
-		cache: NewCache[string, *sql.Stmt](),
+		cache: NewCache[stmtKey, *sql.Stmt](),
 	}
 }
 
 // GetOrPrepare retrieves or prepares a statement
 func (c *PreparedStmtCache) GetOrPrepare(db *sql.DB, query string) (*sql.Stmt, error) {
-	return c.cache.GetOrSet(query, func() (*sql.Stmt, error) {
+	return c.cache.GetOrSet(stmtKey{db, query}, func() (*sql.Stmt, error) {
 		globalMetrics.RecordCacheMiss()
 		stmt, err := db.Prepare(query)
 		if err != nil {
@@ -106,8 +113,8 @@ func (c *PreparedStmtCache) GetOrPrepare(db *sql.DB, query string) (*sql.Stmt, e
 }
 
 // Get retrieves a prepared statement from cache
-func (c *PreparedStmtCache) Get(query string) (*sql.Stmt, bool) {
-	stmt, exists := c.cache.Get(query)
+func (c *PreparedStmtCache) Get(db *sql.DB, query string) (*sql.Stmt, bool) {
+	stmt, exists := c.cache.Get(stmtKey{db, query})
 	if exists {
 		globalMetrics.RecordCacheHit()
 	}
@@ -124,7 +131,7 @@ func (c *PreparedStmtCache) Close() {
 			stmt.Close()
 		}
 	}
-	c.cache.items = make(map[string]*sql.Stmt)
+	c.cache.items = make(map[stmtKey]*sql.Stmt)
 }
 
 // Len returns the number of cached statements
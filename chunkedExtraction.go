@@ -3,13 +3,16 @@ package main
 import (
 	"context"
 	"database/sql"
+	"database/sql/driver"
 	"fmt"
+	"io"
 	"log/slog"
-	"os"
 	"path/filepath"
 	"strings"
 	"sync"
 	"time"
+
+	"github.com/godror/godror"
 )
 
 // ChunkResult represents the result of a chunk extraction
@@ -25,29 +28,78 @@ type ChunkResult struct {
 	Error       error
 }
 
-// runChunkedExtractionForSol performs chunked extraction for a single SOL with debit-credit balancing
-func runChunkedExtractionForSol(ctx context.Context, db *sql.DB, solID string, procedure string, config *ExtractionConfig, templates map[string][]ColumnConfig, logCh chan<- ProcLog, chunkResultsCh chan<- ChunkResult) {
+// chunkBatch holds one fetched chunk as raw cell bytes in template column order.
+// Cells are packed back to back in data and ends[i] is the end offset of cell i,
+// so row r, column c is cell r*cols+c. Batches are reused across chunks.
+type chunkBatch struct {
+	chunkNum      int
+	rows          int
+	cols          int
+	data          []byte
+	ends          []int
+	start         time.Time
+	fetchDuration time.Duration
+	hasMore       bool
+	err           error
+
+	// Scan destinations, reused while the cursor shape stays the same
+	raw      []sql.RawBytes
+	scanArgs []interface{}
+	colIdx   []int
+}
+
+func (b *chunkBatch) reset(chunkNum, cols int) {
+	b.chunkNum = chunkNum
+	b.rows = 0
+	b.cols = cols
+	b.data = b.data[:0]
+	b.ends = b.ends[:0]
+	b.start = time.Now()
+	b.fetchDuration = 0
+	b.hasMore = false
+	b.err = nil
+}
+
+// cell returns the raw bytes of column c in row r
+func (b *chunkBatch) cell(r, c int) []byte {
+	i := r*b.cols + c
+	begin := 0
+	if i > 0 {
+		begin = b.ends[i-1]
+	}
+	return b.data[begin:b.ends[i]]
+}
+
+// runChunkedExtractionForSol performs chunked extraction for a single SOL with debit-credit balancing.
+// Chunks are double-buffered: a fetcher goroutine reads chunk N+1 from the refcursor while this
+// goroutine encodes and writes chunk N, so at most two raw chunks are held per SOL.
+func runChunkedExtractionForSol(ctx context.Context, db *sql.DB, solID string, procedure string, config *ExtractionConfig, templates map[string]*Template, logCh chan<- ProcLog, chunkResultsCh chan<- ChunkResult) {
 	startTime := time.Now()
 	slog.Info("Starting chunked extraction", "sol_id", solID, "procedure", procedure)
 
-	chunkProcName := procedure + "_EXTRACT"
-	chunkNum := 1
+	tmpl := templates[procedure]
+	chunkNum := 0
 	totalRecords := 0
 
-	for {
-		chunkStart := time.Now()
-		slog.Debug("Processing chunk", "chunk_num", chunkNum, "sol_id", solID, "procedure", procedure)
+	fetchCtx, cancel := context.WithCancel(ctx)
+	defer cancel()
+	free := make(chan *chunkBatch, 2)
+	free <- &chunkBatch{}
+	free <- &chunkBatch{}
+	fetched := make(chan *chunkBatch)
+	go fetchChunks(fetchCtx, db, config, procedure, solID, tmpl.Columns, free, fetched)
 
-		// Modern chunked call: gets SYS_REFCURSOR directly from Oracle proc!
-		records, hasMore, err := callChunkProcedure(ctx, db, config.PackageName, chunkProcName, solID, chunkNum, config.ChunkSize)
-		chunkEnd := time.Now()
+	for batch := range fetched {
+		chunkNum = batch.chunkNum
+		chunkStart := batch.start
 
-		if err != nil {
+		if batch.err != nil {
+			chunkEnd := time.Now()
 			slog.Error("Chunk processing failed", 
 				"chunk_num", chunkNum, 
 				"sol_id", solID, 
 				"procedure", procedure, 
-				"error", err)
+				"error", batch.err)
 
 			plog := ProcLog{
 				SolID:         solID,
@@ -56,9 +108,9 @@ func runChunkedExtractionForSol(ctx context.Context, db *sql.DB, solID string, p
 				EndTime:       chunkEnd,
 				ExecutionTime: chunkEnd.Sub(chunkStart),
 				Status:        "FAIL",
-				ErrorDetails:  fmt.Sprintf("Chunk %d failed: %v", chunkNum, err),
+				ErrorDetails:  fmt.Sprintf("Chunk %d failed: %v", chunkNum, batch.err),
 			}
-			logCh <- plog
+			sendProcLog(logCh, plog)
 
 			chunkResultsCh <- ChunkResult{
 				SolID:     solID,
@@ -68,16 +120,20 @@ func runChunkedExtractionForSol(ctx context.Context, db *sql.DB, solID string, p
 				StartTime: chunkStart,
 				EndTime:   chunkEnd,
 				Status:    "FAIL",
-				Error:     err,
+				Error:     batch.err,
 			}
 			return
 		}
 
-		if len(records) == 0 && chunkNum == 1 {
+		if batch.rows == 0 {
+			if chunkNum > 1 {
+				continue
+			}
+			chunkEnd := time.Now()
 			slog.Info("No records found", "sol_id", solID, "procedure", procedure)
 
 			fileName := generateChunkFileName(solID, procedure, 1, 1, config.SpoolOutputPath)
-			if err := createEmptyFile(fileName); err != nil {
+			if err := createEmptyFile(fileName, config); err != nil {
 				slog.Error("Failed to create empty file", "file", fileName, "error", err)
 			}
 
@@ -90,7 +146,7 @@ func runChunkedExtractionForSol(ctx context.Context, db *sql.DB, solID string, p
 				Status:        "SUCCESS",
 				ErrorDetails:  "",
 			}
-			logCh <- plog
+			sendProcLog(logCh, plog)
 
 			chunkResultsCh <- ChunkResult{
 				SolID:       solID,
@@ -106,37 +162,14 @@ func runChunkedExtractionForSol(ctx context.Context, db *sql.DB, solID string, p
 			return
 		}
 
-		if len(records) > 0 {
-			fileName := generateChunkFileName(solID, procedure, chunkNum, -1, config.SpoolOutputPath)
-			if err := writeChunkToFile(fileName, records, templates[procedure], config); err != nil {
-				slog.Error("Failed to write chunk", "chunk_num", chunkNum, "sol_id", solID, "procedure", procedure, "error", err)
-
-				plog := ProcLog{
-					SolID:         solID,
-					Procedure:     procedure,
-					StartTime:     chunkStart,
-					EndTime:       chunkEnd,
-					ExecutionTime: chunkEnd.Sub(chunkStart),
-					Status:        "FAIL",
-					ErrorDetails:  fmt.Sprintf("Failed to write chunk %d: %v", chunkNum, err),
-				}
-				logCh <- plog
-
-				chunkResultsCh <- ChunkResult{
-					SolID:     solID,
-					Procedure: procedure,
-					ChunkNum:  chunkNum,
-					Records:   len(records),
-					StartTime: chunkStart,
-					EndTime:   chunkEnd,
-					Status:    "FAIL",
-					Error:     err,
-				}
-				return
-			}
-
-			totalRecords += len(records)
-			slog.Debug("Chunk completed", "chunk_num", chunkNum, "sol_id", solID, "procedure", procedure, "record_count", len(records))
+		fileName := generateChunkFileName(solID, procedure, chunkNum, -1, config.SpoolOutputPath)
+		writeStart := time.Now()
+		bytesWritten, err := writeChunkToFile(fileName, batch, tmpl.Encoder, config)
+		chunkEnd := time.Now()
+		// Chunk rows are encoded as they are written, so this includes encoding
+		globalMetrics.RecordPhase(procedure, PhaseWrite, chunkEnd.Sub(writeStart))
+		if err != nil {
+			slog.Error("Failed to write chunk", "chunk_num", chunkNum, "sol_id", solID, "procedure", procedure, "error", err)
 
 			plog := ProcLog{
 				SolID:         solID,
@@ -144,31 +177,54 @@ func runChunkedExtractionForSol(ctx context.Context, db *sql.DB, solID string, p
 				StartTime:     chunkStart,
 				EndTime:       chunkEnd,
 				ExecutionTime: chunkEnd.Sub(chunkStart),
-				Status:        "SUCCESS",
-				ErrorDetails:  "",
+				Status:        "FAIL",
+				ErrorDetails:  fmt.Sprintf("Failed to write chunk %d: %v", chunkNum, err),
 			}
-			logCh <- plog
+			sendProcLog(logCh, plog)
 
 			chunkResultsCh <- ChunkResult{
 				SolID:     solID,
 				Procedure: procedure,
 				ChunkNum:  chunkNum,
-				Records:   len(records),
+				Records:   batch.rows,
 				StartTime: chunkStart,
 				EndTime:   chunkEnd,
-				Status:    "SUCCESS",
-				Error:     nil,
+				Status:    "FAIL",
+				Error:     err,
 			}
+			return
 		}
 
-		if !hasMore {
-			break
+		totalRecords += batch.rows
+		globalMetrics.RecordQuery(batch.fetchDuration, int64(batch.rows), bytesWritten)
+		// Refcursors fetch with the driver defaults
+		globalMetrics.RecordEstimatedRoundTrips(estimateRoundTrips(int64(batch.rows), godror.DefaultPrefetchCount, godror.DefaultFetchArraySize))
+		slog.Debug("Chunk completed", "chunk_num", chunkNum, "sol_id", solID, "procedure", procedure, "record_count", batch.rows)
+
+		plog := ProcLog{
+			SolID:         solID,
+			Procedure:     procedure,
+			StartTime:     chunkStart,
+			EndTime:       chunkEnd,
+			ExecutionTime: chunkEnd.Sub(chunkStart),
+			Status:        "SUCCESS",
+			ErrorDetails:  "",
+		}
+		sendProcLog(logCh, plog)
+
+		chunkResultsCh <- ChunkResult{
+			SolID:     solID,
+			Procedure: procedure,
+			ChunkNum:  chunkNum,
+			Records:   batch.rows,
+			StartTime: chunkStart,
+			EndTime:   chunkEnd,
+			Status:    "SUCCESS",
+			Error:     nil,
 		}
-		chunkNum++
-	}
 
-	if chunkNum > 1 {
-		renameChunkFiles(solID, procedure, chunkNum, config.SpoolOutputPath)
+		// Hand the buffer back so the fetcher can fill the next chunk into it
+		free <- batch
 	}
 
 	slog.Info("Completed chunked extraction", 
@@ -179,34 +235,130 @@ func runChunkedExtractionForSol(ctx context.Context, db *sql.DB, solID string, p
 		"duration", time.Since(startTime).Round(time.Millisecond).String())
 }
 
-// callChunkProcedure calls the Oracle procedure with SYS_REFCURSOR output for a chunk
-func callChunkProcedure(ctx context.Context, db *sql.DB, pkgName, procName, solID string, chunkNum, chunkSize int) ([]map[string]interface{}, bool, error) {
-	stmt := fmt.Sprintf(`BEGIN %s.%s(:1, :2, :3, :4); END;`, pkgName, procName)
+// fetchChunks fetches chunks 1, 2, ... into batches taken from free and hands them to fetched,
+// stopping after a short chunk, an error or cancellation. It closes fetched when done.
+func fetchChunks(ctx context.Context, db *sql.DB, config *ExtractionConfig, procedure, solID string, columns []ColumnConfig, free <-chan *chunkBatch, fetched chan<- *chunkBatch) {
+	defer close(fetched)
 
-	var cursor *sql.Rows
-	_, err := db.ExecContext(ctx, stmt,
+	for chunkNum := 1; ; chunkNum++ {
+		var batch *chunkBatch
+		select {
+		case batch = <-free:
+		case <-ctx.Done():
+			return
+		}
+
+		batch.reset(chunkNum, len(columns))
+		slog.Debug("Processing chunk", "chunk_num", chunkNum, "sol_id", solID, "procedure", procedure)
+
+		// Modern chunked call: gets SYS_REFCURSOR directly from Oracle proc!
+		hasMore, err := callChunkProcedure(ctx, db, config.PackageName, procedure, solID, chunkNum, config.ChunkSize, columns, batch)
+		batch.hasMore = hasMore
+		batch.err = err
+		batch.fetchDuration = time.Since(batch.start)
+
+		select {
+		case fetched <- batch:
+		case <-ctx.Done():
+			return
+		}
+		if err != nil || !hasMore {
+			return
+		}
+	}
+}
+
+// callChunkProcedure calls the procedure's _EXTRACT variant, which returns a chunk as a
+// SYS_REFCURSOR, and scans the cursor into batch. It reports whether more chunks may follow.
+// godror only binds a refcursor OUT parameter to a driver.Rows, which must be wrapped on
+// the connection that opened it, so one pooled connection is held from the call until the
+// cursor has been scanned.
+func callChunkProcedure(ctx context.Context, db *sql.DB, pkgName, procedure, solID string, chunkNum, chunkSize int, columns []ColumnConfig, batch *chunkBatch) (bool, error) {
+	stmt := fmt.Sprintf(`BEGIN %s.%s_EXTRACT(:1, :2, :3, :4); END;`, pkgName, procedure)
+
+	conn, err := db.Conn(ctx)
+	if err != nil {
+		return false, fmt.Errorf("failed to get connection: %w", err)
+	}
+	defer conn.Close()
+
+	var rset driver.Rows
+	execStart := time.Now()
+	_, err = conn.ExecContext(ctx, stmt,
 		solID,
 		chunkNum,
 		chunkSize,
-		sql.Out{Dest: &cursor},
+		sql.Out{Dest: &rset},
 	)
 	if err != nil {
-		return nil, false, fmt.Errorf("failed to execute chunk procedure: %w", err)
+		return false, fmt.Errorf("failed to execute chunk procedure: %w", err)
+	}
+	fetchStart := time.Now()
+	globalMetrics.RecordPhase(procedure, PhaseExecute, fetchStart.Sub(execStart))
+	if rset == nil {
+		return false, nil
 	}
-	if cursor == nil {
-		return nil, false, nil
+	cursor, err := godror.WrapRows(ctx, conn, rset)
+	if err != nil {
+		rset.Close()
+		return false, fmt.Errorf("failed to open chunk cursor: %w", err)
 	}
 	defer cursor.Close()
 
-	records, err := rowsToMaps(cursor)
-	if err != nil {
-		return nil, false, fmt.Errorf("failed to convert rows to maps: %w", err)
+	if err := scanChunkRows(cursor, columns, batch); err != nil {
+		return false, fmt.Errorf("failed to scan chunk rows: %w", err)
 	}
+	globalMetrics.RecordPhase(procedure, PhaseFetch, time.Since(fetchStart))
 
 	// More chunks exist if we got exactly chunkSize records
-	hasMore := len(records) == chunkSize
+	hasMore := batch.rows == chunkSize
 
-	return records, hasMore, nil
+	return hasMore, nil
+}
+
+// scanChunkRows scans cursor rows by column index into batch, in template column order.
+// Template columns missing from the cursor are written as empty values.
+func scanChunkRows(rows *sql.Rows, columns []ColumnConfig, batch *chunkBatch) error {
+	cursorCols, err := rows.Columns()
+	if err != nil {
+		return err
+	}
+
+	if len(batch.raw) != len(cursorCols) {
+		batch.raw = make([]sql.RawBytes, len(cursorCols))
+		batch.scanArgs = make([]interface{}, len(cursorCols))
+		for i := range batch.raw {
+			batch.scanArgs[i] = &batch.raw[i]
+		}
+	}
+	if cap(batch.colIdx) < len(columns) {
+		batch.colIdx = make([]int, len(columns))
+	}
+	batch.colIdx = batch.colIdx[:len(columns)]
+	for i, col := range columns {
+		batch.colIdx[i] = -1
+		for j, name := range cursorCols {
+			if strings.EqualFold(name, col.Name) {
+				batch.colIdx[i] = j
+				break
+			}
+		}
+	}
+
+	for rows.Next() {
+		if err := rows.Scan(batch.scanArgs...); err != nil {
+			return err
+		}
+		for _, idx := range batch.colIdx {
+			if idx >= 0 {
+				batch.data = append(batch.data, batch.raw[idx]...)
+			}
+			batch.ends = append(batch.ends, len(batch.data))
+		}
+		batch.rows++
+	}
+
+	return rows.Err()
 }
 
 // generateChunkFileName generates the appropriate file name for a chunk
@@ -223,167 +375,64 @@ func generateChunkFileName(solID, procedure string, chunkNum, totalChunks int, o
 	return filepath.Join(outputPath, fmt.Sprintf("%s_%s_%d.txt", solID, procedure, chunkNum))
 }
 
-// writeChunkToFile writes a chunk of records to a file
-func writeChunkToFile(fileName string, records []map[string]interface{}, columns []ColumnConfig, config *ExtractionConfig) error {
-	file, err := os.Create(fileName)
+// writeChunkToFile writes a chunk of records to a file and returns the number of bytes written
+func writeChunkToFile(fileName string, batch *chunkBatch, encoder *RowEncoder, cfg *ExtractionConfig) (int64, error) {
+	out, err := createOutputFile(fileName, cfg)
 	if err != nil {
-		return fmt.Errorf("failed to create file %s: %w", fileName, err)
+		return 0, err
 	}
-	defer file.Close()
-	
-	// Write records based on format
-	if config.Format == "delimited" {
-		return writeDelimitedChunk(file, records, columns, config.Delimiter)
-	} else {
-		return writeFixedWidthChunk(file, records, columns)
+	written, err := writeEncodedChunk(out, batch, encoder)
+	if err != nil {
+		out.Close()
+		return written, fmt.Errorf("failed to write chunk file %s: %w", fileName, err)
 	}
+	return written, out.Close()
 }
 
-// writeDelimitedChunk writes records in delimited format
-func writeDelimitedChunk(file *os.File, records []map[string]interface{}, columns []ColumnConfig, delimiter string) error {
-	for _, record := range records {
-		var values []string
-		for _, col := range columns {
-			value := ""
-			if val, exists := record[col.Name]; exists && val != nil {
-				value = fmt.Sprintf("%v", val)
-			}
-			values = append(values, value)
-		}
-		
-		var line strings.Builder
-		for i, value := range values {
-			if i > 0 {
-				line.WriteString(delimiter)
-			}
-			line.WriteString(value)
-		}
-		line.WriteString("\n")
-		
-		if _, err := file.WriteString(line.String()); err != nil {
-			return err
-		}
-	}
-	return nil
-}
+// writeEncodedChunk encodes every row of the batch with the template's encoder and
+// returns the number of bytes written, stopping at the first write error
+func writeEncodedChunk(w io.Writer, batch *chunkBatch, encoder *RowEncoder) (int64, error) {
+	var written int64
+	linePtr := lineBufferPool.Get().(*[]byte)
+	line := *linePtr
+	defer func() {
+		*linePtr = line[:0]
+		lineBufferPool.Put(linePtr)
+	}()
 
-// writeFixedWidthChunk writes records in fixed-width format
-func writeFixedWidthChunk(file *os.File, records []map[string]interface{}, columns []ColumnConfig) error {
-	for _, record := range records {
-		line := ""
-		for _, col := range columns {
-			value := ""
-			if val, exists := record[col.Name]; exists && val != nil {
-				value = fmt.Sprintf("%v", val)
-			}
-			
-			// Apply fixed-width formatting
-			if len(value) > col.Length {
-				value = value[:col.Length]
-			}
-			
-			if col.Align == "right" {
-				value = fmt.Sprintf("%*s", col.Length, value)
-			} else {
-				value = fmt.Sprintf("%-*s", col.Length, value)
-			}
-			
-			line += value
+	values := make([]sql.RawBytes, batch.cols)
+	for r := range batch.rows {
+		for c := range values {
+			values[c] = batch.cell(r, c)
 		}
-		line += "\n"
-		
-		if _, err := file.WriteString(line); err != nil {
-			return err
+		line = encoder.AppendRow(line[:0], values)
+		n, err := w.Write(line)
+		written += int64(n)
+		if err != nil {
+			return written, err
 		}
 	}
-	return nil
-}
-
-// renameChunkFiles renames chunk files to include total chunk count
-func renameChunkFiles(solID, procedure string, totalChunks int, outputPath string) {
-	for i := range totalChunks {
-		oldName := filepath.Join(outputPath, fmt.Sprintf("%s_%s_%d.txt", solID, procedure, i+1))
-		newName := filepath.Join(outputPath, fmt.Sprintf("%s_%s_%d.txt", solID, procedure, i+1))
-		
-		// In this case, the naming is already correct, but this function exists
-		// for potential future enhancements where we might want to rename based on total chunks
-		_ = oldName
-		_ = newName
-	}
+	return written, nil
 }
 
-// createEmptyFile creates an empty file for SOLs with no records
-func createEmptyFile(fileName string) error {
-	file, err := os.Create(fileName)
+// createEmptyFile creates an empty output file for SOLs with no records
+func createEmptyFile(fileName string, cfg *ExtractionConfig) error {
+	out, err := createOutputFile(fileName, cfg)
 	if err != nil {
 		return err
 	}
-	defer file.Close()
-	return nil
-}
-
-// rowsToMaps converts SQL rows to a slice of maps for flexible handling
-func rowsToMaps(rows *sql.Rows) ([]map[string]interface{}, error) {
-	columns, err := rows.Columns()
-	if err != nil {
-		return nil, err
-	}
-	
-	var results []map[string]interface{}
-	
-	for rows.Next() {
-		values := make([]interface{}, len(columns))
-		valuePtrs := make([]interface{}, len(columns))
-		
-		for i := range values {
-			valuePtrs[i] = &values[i]
-		}
-		
-		if err := rows.Scan(valuePtrs...); err != nil {
-			return nil, err
-		}
-		
-		record := make(map[string]interface{})
-		for i, col := range columns {
-			record[col] = values[i]
-		}
-		
-		results = append(results, record)
-	}
-	
-	return results, rows.Err()
+	return out.Close()
 }
 
 // runChunkedExtractionForProcedure handles chunked extraction for all SOLs for a given procedure
-func runChunkedExtractionForProcedure(ctx context.Context, db *sql.DB, sols []string, procedure string, config *ExtractionConfig, templates map[string][]ColumnConfig, logCh chan<- ProcLog, mu *sync.Mutex, summary map[string]ProcSummary, concurrency int) {
+func runChunkedExtractionForProcedure(ctx context.Context, db *sql.DB, sols []string, procedure string, config *ExtractionConfig, templates map[string]*Template, logCh chan<- ProcLog, summary *ProcSummaries, concurrency int) {
 	chunkResultsCh := make(chan ChunkResult, len(sols)*10) // Buffer for chunk results
 	defer close(chunkResultsCh)
 	
 	// Start result collector
 	go func() {
 		for result := range chunkResultsCh {
-			mu.Lock()
-			s, exists := summary[result.Procedure]
-			if !exists {
-				s = ProcSummary{
-					Procedure: result.Procedure,
-					StartTime: result.StartTime,
-					EndTime:   result.EndTime,
-					Status:    result.Status,
-				}
-			} else {
-				if result.StartTime.Before(s.StartTime) {
-					s.StartTime = result.StartTime
-				}
-				if result.EndTime.After(s.EndTime) {
-					s.EndTime = result.EndTime
-				}
-				if s.Status != "FAIL" && result.Status == "FAIL" {
-					s.Status = "FAIL"
-				}
-			}
-			summary[result.Procedure] = s
-			mu.Unlock()
+			summary.Record(result.Procedure, result.StartTime, result.EndTime, result.Status)
 		}
 	}()
 	
@@ -0,0 +1,265 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+)
+
+// openChunkTestDB sets the synthetic profile of proc and opens the synthetic database
+func openChunkTestDB(t *testing.T, proc string, profile SyntheticProcedure) *sql.DB {
+	t.Helper()
+	setSyntheticDB(SyntheticDB{Procedures: map[string]SyntheticProcedure{proc: profile}})
+	db, err := sql.Open(syntheticDriverName, "")
+	if err != nil {
+		t.Fatal(err)
+	}
+	t.Cleanup(func() {
+		globalStmtCache.Close()
+		db.Close()
+	})
+	return db
+}
+
+// startFetchChunks starts a fetcher for one SOL with two free batches, as
+// runChunkedExtractionForSol does
+func startFetchChunks(ctx context.Context, db *sql.DB, proc string, profile SyntheticProcedure, chunkSize int) (chan *chunkBatch, chan *chunkBatch) {
+	cfg := &ExtractionConfig{PackageName: "PKG", ChunkSize: chunkSize}
+	free := make(chan *chunkBatch, 2)
+	free <- &chunkBatch{}
+	free <- &chunkBatch{}
+	fetched := make(chan *chunkBatch)
+	go fetchChunks(ctx, db, cfg, proc, "SOL-1", syntheticColumns(profile), free, fetched)
+	return free, fetched
+}
+
+// receiveChunk waits for the next fetched batch
+func receiveChunk(t *testing.T, fetched <-chan *chunkBatch) *chunkBatch {
+	t.Helper()
+	select {
+	case batch, ok := <-fetched:
+		if !ok {
+			t.Fatal("fetcher stopped early")
+		}
+		if batch.err != nil {
+			t.Fatalf("chunk %d: %v", batch.chunkNum, batch.err)
+		}
+		return batch
+	case <-time.After(5 * time.Second):
+		t.Fatal("no chunk fetched")
+	}
+	return nil
+}
+
+// waitFetcherDone drains fetched until the fetcher closes it, returning the batches
+func waitFetcherDone(t *testing.T, fetched <-chan *chunkBatch, within time.Duration) []*chunkBatch {
+	t.Helper()
+	var batches []*chunkBatch
+	deadline := time.After(within)
+	for {
+		select {
+		case batch, ok := <-fetched:
+			if !ok {
+				return batches
+			}
+			batches = append(batches, batch)
+		case <-deadline:
+			t.Fatalf("fetcher still running %v after it should have stopped", within)
+		}
+	}
+}
+
+func TestFetchChunksRotatesTwoBatches(t *testing.T) {
+	const proc, chunkSize = "P_CHUNK_ROTATE", 10
+	profile := SyntheticProcedure{RowsMin: 45, Columns: 6}
+	db := openChunkTestDB(t, proc, profile)
+	free, fetched := startFetchChunks(context.Background(), db, proc, profile, chunkSize)
+
+	// With both batches free the fetcher reads chunk 2 while chunk 1 is still held
+	first := receiveChunk(t, fetched)
+	second := receiveChunk(t, fetched)
+	if first == second {
+		t.Fatal("chunks 1 and 2 share a batch")
+	}
+	select {
+	case batch := <-fetched:
+		t.Fatalf("chunk %d fetched while both batches were held", batch.chunkNum)
+	case <-time.After(20 * time.Millisecond):
+	}
+
+	held := []*chunkBatch{first, second}
+	for chunkNum := 1; chunkNum <= 5; chunkNum++ {
+		batch := held[0]
+		if batch.chunkNum != chunkNum {
+			t.Fatalf("got chunk %d, want %d", batch.chunkNum, chunkNum)
+		}
+		wantRows := min(chunkSize, 45-(chunkNum-1)*chunkSize)
+		if batch.rows != wantRows || batch.hasMore != (wantRows == chunkSize) {
+			t.Errorf("chunk %d: %d rows, more %v; want %d rows", chunkNum, batch.rows, batch.hasMore, wantRows)
+		}
+		if len(batch.ends) != batch.rows*batch.cols {
+			t.Errorf("chunk %d: %d cell ends for %d rows of %d columns", chunkNum, len(batch.ends), batch.rows, batch.cols)
+		}
+		data := &batch.data[0]
+
+		held = held[1:]
+		free <- batch
+		if chunkNum+2 > 5 {
+			continue
+		}
+		next := receiveChunk(t, fetched)
+		if next != batch {
+			t.Fatalf("chunk %d did not reuse the batch of chunk %d", next.chunkNum, chunkNum)
+		}
+		// A full chunk fits the arena the previous chunk grew, so it is filled in place
+		if next.rows == chunkSize && &next.data[0] != data {
+			t.Errorf("chunk %d reallocated the cell arena of chunk %d", next.chunkNum, chunkNum)
+		}
+		held = append(held, next)
+	}
+	if extra := waitFetcherDone(t, fetched, time.Second); len(extra) != 0 {
+		t.Errorf("fetched chunk %d after the short chunk", extra[0].chunkNum)
+	}
+}
+
+func TestFetchChunksStopsWhenConsumerExits(t *testing.T) {
+	const proc = "P_CHUNK_EXIT"
+	profile := SyntheticProcedure{RowsMin: 100, Columns: 4}
+	db := openChunkTestDB(t, proc, profile)
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	_, fetched := startFetchChunks(ctx, db, proc, profile, 10)
+
+	// The consumer keeps chunk 1 and leaves, as it does after a write error; the fetcher is
+	// blocked handing over chunk 2 and must exit on cancel instead of leaking
+	receiveChunk(t, fetched)
+	time.Sleep(10 * time.Millisecond)
+	cancel()
+	for _, batch := range waitFetcherDone(t, fetched, time.Second) {
+		if batch.chunkNum > 2 {
+			t.Errorf("chunk %d fetched with both batches held", batch.chunkNum)
+		}
+	}
+}
+
+func TestFetchChunksCancelDuringFetch(t *testing.T) {
+	const proc = "P_CHUNK_CANCEL"
+	profile := SyntheticProcedure{RowsMin: 100, Columns: 4, RoundTripMs: 500}
+	db := openChunkTestDB(t, proc, profile)
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	_, fetched := startFetchChunks(ctx, db, proc, profile, 10)
+
+	time.Sleep(20 * time.Millisecond)
+	cancel()
+	// Chunk 1's call is in flight; it has to be abandoned well before its round trip ends
+	for _, batch := range waitFetcherDone(t, fetched, 250*time.Millisecond) {
+		if !errors.Is(batch.err, context.Canceled) {
+			t.Errorf("chunk %d handed over after cancel with error %v", batch.chunkNum, batch.err)
+		}
+	}
+}
+
+func TestChunkedExtractionMatchesExtractData(t *testing.T) {
+	tests := []struct {
+		name string
+		rows int
+	}{
+		{"short last chunk", 33},
+		{"exact multiple", 21}, // the last call returns an empty chunk that writes no file
+		{"single chunk", 5},
+	}
+	for i, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			const chunkSize = 7
+			proc := fmt.Sprintf("P_CHUNK_CMP%d", i)
+			profile := SyntheticProcedure{RowsMin: tt.rows, Columns: 9}
+			db := openChunkTestDB(t, proc, profile)
+
+			dir := t.TempDir()
+			cols := syntheticColumns(profile)
+			cfg := &ExtractionConfig{PackageName: "PKG", Format: "fixed", ChunkSize: chunkSize, SpoolOutputPath: dir, FetchBufferKB: 512}
+			fetchArraySize, prefetchCount := fetchSizes(cols, cfg)
+			templates := map[string]*Template{proc: {Columns: cols, Encoder: NewRowEncoder(cols, cfg.Format, ""), FetchArraySize: fetchArraySize, PrefetchCount: prefetchCount}}
+
+			if err := extractData(context.Background(), db, proc, "SOL-1", cfg, templates, nil, 0); err != nil {
+				t.Fatal(err)
+			}
+			want, err := os.ReadFile(filepath.Join(dir, proc+"_SOL-1.spool"))
+			if err != nil {
+				t.Fatal(err)
+			}
+
+			logCh := make(chan ProcLog, 16)
+			chunkResultsCh := make(chan ChunkResult, 16)
+			runChunkedExtractionForSol(context.Background(), db, "SOL-1", proc, cfg, templates, logCh, chunkResultsCh)
+			close(logCh)
+			close(chunkResultsCh)
+			for plog := range logCh {
+				if plog.Status != "SUCCESS" {
+					t.Fatalf("chunk failed: %s", plog.ErrorDetails)
+				}
+			}
+
+			chunks := (tt.rows + chunkSize - 1) / chunkSize
+			var got strings.Builder
+			for chunkNum := 1; chunkNum <= chunks; chunkNum++ {
+				data, err := os.ReadFile(generateChunkFileName("SOL-1", proc, chunkNum, -1, dir))
+				if err != nil {
+					t.Fatal(err)
+				}
+				got.Write(data)
+			}
+			if _, err := os.Stat(generateChunkFileName("SOL-1", proc, chunks+1, -1, dir)); err == nil {
+				t.Errorf("chunk file %d written past the last row", chunks+1)
+			}
+			if got.String() != string(want) {
+				t.Errorf("chunk files hold %d bytes that differ from the query's %d", got.Len(), len(want))
+			}
+		})
+	}
+}
+
+// failingWriter accepts limit bytes and fails every write after
+type failingWriter struct {
+	limit int
+}
+
+func (w *failingWriter) Write(p []byte) (int, error) {
+	if len(p) > w.limit {
+		n := w.limit
+		w.limit = 0
+		return n, errors.New("disk full")
+	}
+	w.limit -= len(p)
+	return len(p), nil
+}
+
+func TestWriteEncodedChunkReportsWriteError(t *testing.T) {
+	cols := []ColumnConfig{{Name: "A", Length: 4}, {Name: "B", Length: 6}}
+	encoder := NewRowEncoder(cols, "fixed", "")
+	batch := &chunkBatch{}
+	batch.reset(1, len(cols))
+	for range 5 {
+		for _, cell := range []string{"ab", "cdef"} {
+			batch.data = append(batch.data, cell...)
+			batch.ends = append(batch.ends, len(batch.data))
+		}
+		batch.rows++
+	}
+	lineLen := len(encoder.AppendRow(nil, []sql.RawBytes{batch.cell(0, 0), batch.cell(0, 1)}))
+
+	written, err := writeEncodedChunk(&failingWriter{limit: 2*lineLen + 3}, batch, encoder)
+	if err == nil {
+		t.Fatal("write error not returned")
+	}
+	if want := int64(2*lineLen + 3); written != want {
+		t.Errorf("%d bytes reported written, want the %d the writer took", written, want)
+	}
+}
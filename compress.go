@@ -0,0 +1,265 @@
+package main
+
+import (
+	"bufio"
+	"bytes"
+	"compress/gzip"
+	"fmt"
+	"io"
+	"os"
+	"runtime"
+	"strconv"
+	"sync"
+)
+
+// Output compression writes each file as a sequence of independently compressed blocks.
+// Every block is a complete gzip member, so the concatenation is an ordinary gzip stream
+// for gunzip and zcat, while the .idx sidecar lets readers seek to and inflate any block
+// on its own, in parallel.
+
+const compressionGzip = "gzip"
+
+// compressJob is one block handed to the compression workers
+type compressJob struct {
+	level int
+	src   *[]byte
+	out   *bytes.Buffer
+	err   error
+	done  chan struct{}
+}
+
+var (
+	compressOnce  sync.Once
+	compressQueue chan *compressJob
+	compressCount int
+
+	// compressedBufferPool reuses compressed block buffers
+	compressedBufferPool = sync.Pool{
+		New: func() interface{} {
+			return new(bytes.Buffer)
+		},
+	}
+)
+
+// startCompressionWorkers starts the shared compression workers on first use; later
+// calls keep the first worker count
+func startCompressionWorkers(workers int) {
+	compressOnce.Do(func() {
+		if workers <= 0 {
+			workers = runtime.NumCPU()
+		}
+		compressCount = workers
+		compressQueue = make(chan *compressJob, workers*2)
+		for range workers {
+			go compressWorker(compressQueue)
+		}
+	})
+}
+
+func compressWorker(jobs <-chan *compressJob) {
+	var zw *gzip.Writer
+	level := 0
+	for job := range jobs {
+		if zw == nil || job.level != level {
+			zw, job.err = gzip.NewWriterLevel(job.out, job.level)
+			level = job.level
+		} else {
+			zw.Reset(job.out)
+		}
+		if job.err == nil {
+			if _, job.err = zw.Write(*job.src); job.err == nil {
+				job.err = zw.Close()
+			}
+		} else {
+			zw = nil
+		}
+		close(job.done)
+	}
+}
+
+// blockIndexEntry locates one compressed block in the file
+type blockIndexEntry struct {
+	rawOffset        int64
+	rawLength        int64
+	compressedOffset int64
+	compressedLength int64
+}
+
+// BlockWriter splits its input into blockSize blocks, compresses them on the shared
+// workers and writes them to dst in input order. Up to one block per worker is in flight,
+// so a single file can keep every core busy while the caller keeps encoding rows.
+// Errors are sticky and reported by later writes and Close.
+type BlockWriter struct {
+	dst         io.Writer
+	level       int
+	blockSize   int
+	block       *[]byte
+	blockPool   *sync.Pool
+	inflight    []*compressJob
+	maxInflight int
+	index       []blockIndexEntry
+	rawOffset   int64
+	written     int64 // compressed bytes written to dst
+	err         error
+}
+
+// blockPools holds one pool of block buffers per block size
+var blockPools sync.Map // int -> *sync.Pool
+
+func NewBlockWriter(dst io.Writer, level, blockSize, workers int) *BlockWriter {
+	startCompressionWorkers(workers)
+	p, ok := blockPools.Load(blockSize)
+	if !ok {
+		p, _ = blockPools.LoadOrStore(blockSize, &sync.Pool{
+			New: func() interface{} {
+				b := make([]byte, 0, blockSize)
+				return &b
+			},
+		})
+	}
+	bw := &BlockWriter{
+		dst:         dst,
+		level:       level,
+		blockSize:   blockSize,
+		blockPool:   p.(*sync.Pool),
+		maxInflight: compressCount,
+	}
+	bw.block = bw.blockPool.Get().(*[]byte)
+	return bw
+}
+
+func (bw *BlockWriter) Write(p []byte) (int, error) {
+	n := 0
+	for len(p) > 0 && bw.err == nil {
+		free := bw.blockSize - len(*bw.block)
+		chunk := p[:min(free, len(p))]
+		*bw.block = append(*bw.block, chunk...)
+		n += len(chunk)
+		p = p[len(chunk):]
+		if len(*bw.block) == bw.blockSize {
+			bw.submit()
+		}
+	}
+	return n, bw.err
+}
+
+// ReadFrom fills blocks straight from r, sparing the merge a copy through a buffer
+func (bw *BlockWriter) ReadFrom(r io.Reader) (int64, error) {
+	var total int64
+	for bw.err == nil {
+		block := *bw.block
+		n, err := r.Read(block[len(block):bw.blockSize])
+		*bw.block = block[:len(block)+n]
+		total += int64(n)
+		if len(*bw.block) == bw.blockSize {
+			bw.submit()
+		}
+		if err == io.EOF {
+			return total, bw.err
+		}
+		if err != nil {
+			return total, err
+		}
+	}
+	return total, bw.err
+}
+
+// submit hands the current block to the workers and writes out finished blocks
+func (bw *BlockWriter) submit() {
+	job := &compressJob{
+		level: bw.level,
+		src:   bw.block,
+		out:   compressedBufferPool.Get().(*bytes.Buffer),
+		done:  make(chan struct{}),
+	}
+	compressQueue <- job
+	bw.inflight = append(bw.inflight, job)
+	bw.block = bw.blockPool.Get().(*[]byte)
+
+	// Wait only when the window is full; otherwise write whatever is already done
+	for len(bw.inflight) > 0 {
+		if len(bw.inflight) < bw.maxInflight {
+			select {
+			case <-bw.inflight[0].done:
+			default:
+				return
+			}
+		}
+		bw.writeHead()
+	}
+}
+
+// writeHead waits for the oldest in-flight block and writes it
+func (bw *BlockWriter) writeHead() {
+	job := bw.inflight[0]
+	<-job.done
+	bw.inflight[0] = nil
+	bw.inflight = bw.inflight[1:]
+
+	rawLength := int64(len(*job.src))
+	if bw.err == nil {
+		bw.err = job.err
+	}
+	if bw.err == nil {
+		n, err := bw.dst.Write(job.out.Bytes())
+		bw.index = append(bw.index, blockIndexEntry{
+			rawOffset:        bw.rawOffset,
+			rawLength:        rawLength,
+			compressedOffset: bw.written,
+			compressedLength: int64(n),
+		})
+		bw.written += int64(n)
+		bw.err = err
+	}
+	bw.rawOffset += rawLength
+
+	*job.src = (*job.src)[:0]
+	bw.blockPool.Put(job.src)
+	job.out.Reset()
+	compressedBufferPool.Put(job.out)
+}
+
+// Close compresses the last partial block and waits for every block to be written. A file
+// with no input still gets one empty member, so it is valid gzip.
+func (bw *BlockWriter) Close() error {
+	if len(*bw.block) > 0 || (len(bw.index) == 0 && len(bw.inflight) == 0) {
+		bw.submit()
+	}
+	for len(bw.inflight) > 0 {
+		bw.writeHead()
+	}
+	bw.blockPool.Put(bw.block)
+	bw.block = nil
+	return bw.err
+}
+
+// Written returns the compressed bytes written so far
+func (bw *BlockWriter) Written() int64 {
+	return bw.written
+}
+
+// writeBlockIndex writes the block index sidecar as CSV, one row per block
+func writeBlockIndex(path string, index []blockIndexEntry) error {
+	f, err := os.Create(path)
+	if err != nil {
+		return fmt.Errorf("failed to create block index %s: %w", path, err)
+	}
+	defer f.Close()
+
+	w := bufio.NewWriter(f)
+	w.WriteString("BLOCK,RAW_OFFSET,RAW_LENGTH,COMPRESSED_OFFSET,COMPRESSED_LENGTH\n")
+	var line []byte
+	for i, e := range index {
+		line = strconv.AppendInt(line[:0], int64(i), 10)
+		for _, v := range []int64{e.rawOffset, e.rawLength, e.compressedOffset, e.compressedLength} {
+			line = append(line, ',')
+			line = strconv.AppendInt(line, v, 10)
+		}
+		line = append(line, '\n')
+		w.Write(line)
+	}
+	if err := w.Flush(); err != nil {
+		return fmt.Errorf("failed to write block index %s: %w", path, err)
+	}
+	return f.Close()
+}
@@ -0,0 +1,171 @@
+package main
+
+import (
+	"bytes"
+	"compress/gzip"
+	"encoding/csv"
+	"fmt"
+	"io"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"strconv"
+	"testing"
+)
+
+// testText returns n bytes of line-structured, partly random text
+func testText(n int) []byte {
+	rng := rand.New(rand.NewSource(int64(n)))
+	var b []byte
+	for row := 0; len(b) < n; row++ {
+		b = fmt.Appendf(b, "SOL%07d|%d|", row, rng.Int63())
+		for range rng.Intn(40) {
+			b = append(b, byte('A'+rng.Intn(26)))
+		}
+		b = append(b, '\n')
+	}
+	return b[:n]
+}
+
+// checkBlocks inflates the gzip file as one stream and each indexed member on its own,
+// and checks both against raw
+func checkBlocks(t *testing.T, compressed, raw []byte, index []blockIndexEntry) {
+	t.Helper()
+	zr, err := gzip.NewReader(bytes.NewReader(compressed))
+	if err != nil {
+		t.Fatal(err)
+	}
+	got, err := io.ReadAll(zr)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !bytes.Equal(got, raw) {
+		t.Fatalf("gzip stream inflates to %d bytes that differ from the %d bytes written", len(got), len(raw))
+	}
+
+	if len(index) == 0 {
+		t.Fatal("empty block index")
+	}
+	var rawOffset, compressedOffset int64
+	for i, e := range index {
+		if e.rawOffset != rawOffset || e.compressedOffset != compressedOffset {
+			t.Fatalf("block %d at raw %d compressed %d, want raw %d compressed %d",
+				i, e.rawOffset, e.compressedOffset, rawOffset, compressedOffset)
+		}
+		member := compressed[e.compressedOffset : e.compressedOffset+e.compressedLength]
+		zr, err := gzip.NewReader(bytes.NewReader(member))
+		if err != nil {
+			t.Fatalf("block %d: %v", i, err)
+		}
+		zr.Multistream(false)
+		block, err := io.ReadAll(zr)
+		if err != nil {
+			t.Fatalf("block %d: %v", i, err)
+		}
+		if !bytes.Equal(block, raw[e.rawOffset:e.rawOffset+e.rawLength]) {
+			t.Fatalf("block %d does not inflate to raw bytes %d-%d", i, e.rawOffset, e.rawOffset+e.rawLength)
+		}
+		rawOffset += e.rawLength
+		compressedOffset += e.compressedLength
+	}
+	if rawOffset != int64(len(raw)) || compressedOffset != int64(len(compressed)) {
+		t.Fatalf("index covers %d raw and %d compressed bytes, want %d and %d",
+			rawOffset, compressedOffset, len(raw), len(compressed))
+	}
+}
+
+func TestBlockWriterRoundTrip(t *testing.T) {
+	const blockSize = 4096
+	for _, size := range []int{0, 1, blockSize - 1, blockSize, blockSize + 1, 50*blockSize + 123} {
+		t.Run(strconv.Itoa(size), func(t *testing.T) {
+			raw := testText(size)
+			var dst bytes.Buffer
+			bw := NewBlockWriter(&dst, gzip.DefaultCompression, blockSize, 4)
+			// Odd write sizes so writes straddle block boundaries
+			for p := raw; len(p) > 0; {
+				n := min(len(p), 1+len(p)%777)
+				if _, err := bw.Write(p[:n]); err != nil {
+					t.Fatal(err)
+				}
+				p = p[n:]
+			}
+			if err := bw.Close(); err != nil {
+				t.Fatal(err)
+			}
+			if bw.Written() != int64(dst.Len()) {
+				t.Errorf("Written() = %d, want %d", bw.Written(), dst.Len())
+			}
+			checkBlocks(t, dst.Bytes(), raw, bw.index)
+			if size > 0 && len(bw.index) != (size+blockSize-1)/blockSize {
+				t.Errorf("%d blocks for %d bytes, want %d", len(bw.index), size, (size+blockSize-1)/blockSize)
+			}
+		})
+	}
+}
+
+func TestBlockWriterReadFrom(t *testing.T) {
+	raw := testText(100_000)
+	var dst bytes.Buffer
+	bw := NewBlockWriter(&dst, gzip.BestSpeed, 3000, 4)
+	if n, err := bw.ReadFrom(bytes.NewReader(raw)); err != nil || n != int64(len(raw)) {
+		t.Fatalf("ReadFrom = %d, %v", n, err)
+	}
+	if err := bw.Close(); err != nil {
+		t.Fatal(err)
+	}
+	checkBlocks(t, dst.Bytes(), raw, bw.index)
+}
+
+// readBlockIndex parses a .gz.idx sidecar
+func readBlockIndex(t *testing.T, path string) []blockIndexEntry {
+	t.Helper()
+	f, err := os.Open(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer f.Close()
+	records, err := csv.NewReader(f).ReadAll()
+	if err != nil {
+		t.Fatal(err)
+	}
+	var index []blockIndexEntry
+	for i, rec := range records[1:] {
+		if rec[0] != strconv.Itoa(i) {
+			t.Fatalf("index row %d is numbered %s", i, rec[0])
+		}
+		var v [4]int64
+		for j := range v {
+			if v[j], err = strconv.ParseInt(rec[j+1], 10, 64); err != nil {
+				t.Fatal(err)
+			}
+		}
+		index = append(index, blockIndexEntry{rawOffset: v[0], rawLength: v[1], compressedOffset: v[2], compressedLength: v[3]})
+	}
+	return index
+}
+
+func TestOutputFileWritesBlockIndex(t *testing.T) {
+	cfg := &ExtractionConfig{Compression: compressionGzip, CompressionLevel: gzip.DefaultCompression, CompressionBlockKB: 1, CompressionWorkers: 4}
+	path := filepath.Join(t.TempDir(), "P_TEST.txt")
+	f, err := createOutputFile(path, cfg)
+	if err != nil {
+		t.Fatal(err)
+	}
+	raw := testText(64*1024 + 17)
+	if _, err := f.Write(raw); err != nil {
+		t.Fatal(err)
+	}
+	if err := f.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	compressed, err := os.ReadFile(path + ".gz")
+	if err != nil {
+		t.Fatal(err)
+	}
+	index := readBlockIndex(t, path+".gz.idx")
+	if len(index) != 65 {
+		t.Errorf("%d indexed blocks, want 65", len(index))
+	}
+	checkBlocks(t, compressed, raw, index)
+}
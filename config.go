@@ -2,21 +2,28 @@ package main
 
 import (
 	"bufio"
+	"compress/gzip"
 	"encoding/json"
 	"fmt"
 	"os"
+	"runtime"
 	"slices"
 )
 
 type MainConfig struct {
-	DBUser      string `json:"db_user"`
-	DBPassword  string `json:"db_password"`
-	DBHost      string `json:"db_host"`
-	DBPort      int    `json:"db_port"`
-	DBSid       string `json:"db_sid"`
-	Concurrency int    `json:"concurrency"`
-	LogFilePath string `json:"log_path"`
-	SolFilePath string `json:"sol_list_path"`
+	DBUser         string `json:"db_user"`
+	DBPassword     string `json:"db_password"`
+	DBHost         string `json:"db_host"`
+	DBPort         int    `json:"db_port"`
+	DBSid          string `json:"db_sid"`
+	Concurrency    int    `json:"concurrency"`               // Initial tasks in flight; the scheduler adapts it at runtime
+	MaxConnections int    `json:"max_connections,omitempty"` // Pool size and concurrency ceiling; 0 derives it from concurrency
+	LogFilePath    string `json:"log_path"`
+	SolFilePath    string `json:"sol_list_path"`
+	// Metrics export
+	MetricsPort            int    `json:"metrics_port,omitempty"`             // Serve Prometheus text on 127.0.0.1:<port>/metrics; 0 disables
+	MetricsSnapshotPath    string `json:"metrics_snapshot_path,omitempty"`    // JSON snapshot file rewritten periodically and at exit
+	MetricsSnapshotSeconds int    `json:"metrics_snapshot_seconds,omitempty"` // Default: 30 seconds between snapshots
 }
 
 type ExtractionConfig struct {
@@ -33,6 +40,27 @@ type ExtractionConfig struct {
 	ChunkedProcedures     []string `json:"chunked_procedures,omitempty"`     // Procedures that use chunked logic
 	ChunkSize             int      `json:"chunk_size,omitempty"`             // Default: 5000 records per chunk
 	ChunkProcedureSuffix  string   `json:"chunk_procedure_suffix,omitempty"` // Suffix for chunk procedures (e.g., "_CHUNK")
+	// Direct output: write <proc>.txt during extraction instead of spooling and merging.
+	// Tasks then start in SOL order instead of longest first: the reorder buffer only
+	// guarantees progress while SOLs start in sequence, so a long SOL late in the list
+	// can still finish last and lengthen the run's tail.
+	DirectOutput          bool     `json:"direct_output,omitempty"`
+	ReorderBufferMB       int      `json:"reorder_buffer_mb,omitempty"` // Default: 64MB of out-of-order SOL segments per procedure
+	// Set-based extraction and fetch tuning
+	SolBatchSize          int      `json:"sol_batch_size,omitempty"`   // SOL IDs per query; 0 or 1 queries one SOL at a time (max 1000)
+	FetchArraySize        int      `json:"fetch_array_size,omitempty"` // Rows per fetch round trip; 0 sizes it from the template row width
+	PrefetchCount         int      `json:"prefetch_count,omitempty"`   // Rows returned with the execute; 0 uses the fetch array size
+	FetchBufferKB         int      `json:"fetch_buffer_kb,omitempty"`  // Default: 512KB of row data per fetch when sizing from the template
+	NativeFetchProcedures []string `json:"native_fetch_procedures,omitempty"` // Procedures whose single-SOL queries are read on the driver connection
+	// Batched procedure calls for insert mode (procedure-level parallelism only)
+	InsertBatchSize       int      `json:"insert_batch_size,omitempty"`      // Initial SOLs per call; 0 or 1 calls one SOL at a time
+	InsertBatchMaxSize    int      `json:"insert_batch_max_size,omitempty"`  // Default and limit: 100 SOLs per call, each holding a 32KB error buffer during the call
+	InsertBatchTargetMs   int      `json:"insert_batch_target_ms,omitempty"` // Default: 2000ms per call before the batch size shrinks
+	// Output compression: "gzip" writes <file>.gz as independently compressed blocks plus a <file>.gz.idx block index
+	Compression        string `json:"compression,omitempty"`          // "gzip" or empty for plain text
+	CompressionLevel   int    `json:"compression_level,omitempty"`    // gzip level 1-9; 0 uses the gzip default
+	CompressionBlockKB int    `json:"compression_block_kb,omitempty"` // Default: 1024KB of text per block
+	CompressionWorkers int    `json:"compression_workers,omitempty"`  // Default: one per CPU, shared by all output files
 }
 
 func loadMainConfig(path string) (MainConfig, error) {
@@ -87,6 +115,11 @@ func isChunkedProcedure(proc string, chunkedProcs []string) bool {
 	return slices.Contains(chunkedProcs, proc)
 }
 
+// Check if a procedure reads its rows through native fetch
+func isNativeFetchProcedure(proc string, nativeProcs []string) bool {
+	return slices.Contains(nativeProcs, proc)
+}
+
 // Set default values for chunked configuration
 func setChunkedDefaults(config *ExtractionConfig) {
 	if config.ChunkSize == 0 {
@@ -94,3 +127,70 @@ func setChunkedDefaults(config *ExtractionConfig) {
 	}
 	// Note: ChunkProcedureSuffix is not used - hardcoded "_EXTRACT" in chunkedExtraction.go
 }
+
+// Set default values for direct output configuration
+func setOutputDefaults(config *ExtractionConfig) {
+	if config.ReorderBufferMB <= 0 {
+		config.ReorderBufferMB = 64
+	}
+}
+
+// Set default values for batched extraction and fetch sizing
+func setFetchDefaults(config *ExtractionConfig) {
+	if config.SolBatchSize > 1000 {
+		config.SolBatchSize = 1000 // Oracle IN-list limit
+	}
+	if config.FetchBufferKB <= 0 {
+		config.FetchBufferKB = 512
+	}
+}
+
+// maxInsertBatchSize caps the SOLs per batched call. Each SOL's error text is an OUT
+// VARCHAR that godror binds with a batchErrorBufferSize buffer, although
+// FORMAT_ERROR_STACK returns at most 2000 bytes, so one call holds about 3MB at the cap,
+// times the calls in flight.
+const (
+	maxInsertBatchSize   = 100
+	batchErrorBufferSize = 32767
+)
+
+// Set default values for batched procedure calls
+func setInsertBatchDefaults(config *ExtractionConfig) {
+	if config.InsertBatchMaxSize <= 0 || config.InsertBatchMaxSize > maxInsertBatchSize {
+		config.InsertBatchMaxSize = maxInsertBatchSize
+	}
+	if config.InsertBatchTargetMs <= 0 {
+		config.InsertBatchTargetMs = 2000
+	}
+}
+
+// Set default values for output compression
+func setCompressionDefaults(config *ExtractionConfig) error {
+	switch config.Compression {
+	case "", "none":
+		config.Compression = ""
+		return nil
+	case compressionGzip:
+	default:
+		return fmt.Errorf("unsupported compression %q, expected \"gzip\" or empty", config.Compression)
+	}
+	if config.CompressionLevel == 0 {
+		config.CompressionLevel = gzip.DefaultCompression
+	} else if config.CompressionLevel < gzip.BestSpeed || config.CompressionLevel > gzip.BestCompression {
+		return fmt.Errorf("invalid compression_level %d, expected 1-9", config.CompressionLevel)
+	}
+	if config.CompressionBlockKB <= 0 {
+		config.CompressionBlockKB = 1024
+	}
+	if config.CompressionWorkers <= 0 {
+		config.CompressionWorkers = runtime.NumCPU()
+	}
+	return nil
+}
+
+// setMetricsDefaults sets the metrics export defaults
+func setMetricsDefaults(config *MainConfig) {
+	if config.MetricsSnapshotSeconds <= 0 {
+		config.MetricsSnapshotSeconds = 30
+	}
+}
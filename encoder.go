@@ -0,0 +1,194 @@
+package main
+
+import (
+	"database/sql"
+	"database/sql/driver"
+	"fmt"
+	"strconv"
+	"sync"
+	"time"
+
+	"github.com/godror/godror"
+)
+
+// RowEncoder formats raw column values into output lines. It is compiled once per
+// template so that every column's offset, width and alignment is known up front,
+// and encoding a row performs no allocations beyond growing the destination buffer.
+type RowEncoder struct {
+	delimited bool
+	delimiter []byte
+	columns   []encodedColumn
+	lineWidth int // fixed-width line length, excluding the newline
+}
+
+type encodedColumn struct {
+	offset int
+	width  int
+	right  bool
+}
+
+// NewRowEncoder compiles an encoder for the given template columns.
+// Any format other than "delimited" is encoded as fixed width.
+func NewRowEncoder(cols []ColumnConfig, format, delimiter string) *RowEncoder {
+	enc := &RowEncoder{
+		delimited: format == "delimited",
+		delimiter: []byte(delimiter),
+		columns:   make([]encodedColumn, len(cols)),
+	}
+	offset := 0
+	for i, col := range cols {
+		width := max(col.Length, 0)
+		enc.columns[i] = encodedColumn{offset: offset, width: width, right: col.Align == "right"}
+		offset += width
+	}
+	enc.lineWidth = offset
+	return enc
+}
+
+// AppendRow appends the encoded row and a trailing newline to dst.
+// Values beyond the template's columns are ignored and missing values are empty.
+func (e *RowEncoder) AppendRow(dst []byte, values []sql.RawBytes) []byte {
+	if e.delimited {
+		return e.appendDelimited(dst, values)
+	}
+	return e.appendFixed(dst, values)
+}
+
+func (e *RowEncoder) appendDelimited(dst []byte, values []sql.RawBytes) []byte {
+	for i := range e.columns {
+		if i > 0 {
+			dst = append(dst, e.delimiter...)
+		}
+		if i < len(values) {
+			start := len(dst)
+			dst = append(dst, values[i]...)
+			scrubLineBreaks(dst[start:])
+		}
+	}
+	return append(dst, '\n')
+}
+
+func (e *RowEncoder) appendFixed(dst []byte, values []sql.RawBytes) []byte {
+	// Lay down a line of spaces, then copy each value into its slot
+	base := len(dst)
+	dst = appendSpaces(dst, e.lineWidth)
+	line := dst[base:]
+	for i, col := range e.columns {
+		if i >= len(values) {
+			break
+		}
+		value := values[i]
+		if len(value) > col.width {
+			value = value[:col.width]
+		}
+		slot := line[col.offset : col.offset+col.width]
+		if col.right {
+			slot = slot[col.width-len(value):]
+		}
+		copy(slot, value)
+		scrubLineBreaks(slot[:len(value)])
+	}
+	return append(dst, '\n')
+}
+
+// AppendValues appends the encoded row of driver values and a trailing newline to dst.
+// Each value is formatted exactly as scanning it into sql.RawBytes would, but straight
+// into the line, so the native fetch path skips the scan copy.
+func (e *RowEncoder) AppendValues(dst []byte, values []driver.Value) []byte {
+	if e.delimited {
+		for i := range e.columns {
+			if i > 0 {
+				dst = append(dst, e.delimiter...)
+			}
+			if i < len(values) {
+				start := len(dst)
+				dst = appendDriverValue(dst, values[i])
+				scrubLineBreaks(dst[start:])
+			}
+		}
+		return append(dst, '\n')
+	}
+
+	base := len(dst)
+	dst = appendSpaces(dst, e.lineWidth)
+	for i, col := range e.columns {
+		if i >= len(values) {
+			break
+		}
+		// Format past the end of the line, then move the value into its slot
+		scratch := len(dst)
+		dst = appendDriverValue(dst, values[i])
+		value := dst[scratch:]
+		if len(value) > col.width {
+			value = value[:col.width]
+		}
+		slot := dst[base+col.offset : base+col.offset+col.width]
+		if col.right {
+			slot = slot[col.width-len(value):]
+		}
+		copy(slot, value)
+		scrubLineBreaks(slot[:len(value)])
+		dst = dst[:scratch]
+	}
+	return append(dst, '\n')
+}
+
+// appendDriverValue formats a value as returned by the driver's Rows.Next, matching
+// database/sql's conversion to sql.RawBytes: NULL is empty and times are RFC 3339
+func appendDriverValue(dst []byte, v driver.Value) []byte {
+	switch v := v.(type) {
+	case nil:
+		return dst
+	case string:
+		return append(dst, v...)
+	case []byte:
+		return append(dst, v...)
+	case godror.Number:
+		return append(dst, v...)
+	case int64:
+		return strconv.AppendInt(dst, v, 10)
+	case uint64:
+		return strconv.AppendUint(dst, v, 10)
+	case float64:
+		return strconv.AppendFloat(dst, v, 'g', -1, 64)
+	case float32:
+		return strconv.AppendFloat(dst, float64(v), 'g', -1, 32)
+	case bool:
+		return strconv.AppendBool(dst, v)
+	case time.Time:
+		return v.AppendFormat(dst, time.RFC3339Nano)
+	default:
+		return fmt.Append(dst, v)
+	}
+}
+
+// scrubLineBreaks replaces CR and LF with spaces in place
+func scrubLineBreaks(b []byte) {
+	for i, c := range b {
+		if c == '\n' || c == '\r' {
+			b[i] = ' '
+		}
+	}
+}
+
+const spaces = "                                                                "
+
+// appendSpaces appends n spaces to b
+func appendSpaces(b []byte, n int) []byte {
+	for n > len(spaces) {
+		b = append(b, spaces...)
+		n -= len(spaces)
+	}
+	if n > 0 {
+		b = append(b, spaces[:n]...)
+	}
+	return b
+}
+
+// lineBufferPool holds reusable output line buffers for the row encoders
+var lineBufferPool = sync.Pool{
+	New: func() interface{} {
+		b := make([]byte, 0, 4096)
+		return &b
+	},
+}
@@ -0,0 +1,70 @@
+package main
+
+import (
+	"database/sql"
+	"fmt"
+	"strings"
+	"testing"
+)
+
+var benchColumnCounts = []int{10, 50, 200}
+
+// syntheticRow builds a template of numCols columns with mixed widths and alignment,
+// and one row of values that exercises padding, truncation and CR/LF scrubbing
+func syntheticRow(numCols int) ([]ColumnConfig, []sql.RawBytes) {
+	widths := []int{8, 12, 20, 32}
+	cols := make([]ColumnConfig, numCols)
+	values := make([]sql.RawBytes, numCols)
+	for i := range numCols {
+		width := widths[i%len(widths)]
+		cols[i] = ColumnConfig{Name: fmt.Sprintf("COL_%d", i+1), Length: width, Align: "left"}
+		if i%3 == 0 {
+			cols[i].Align = "right"
+		}
+		switch i % 5 {
+		case 0:
+			values[i] = sql.RawBytes(strings.Repeat("9", width/2))
+		case 1:
+			values[i] = sql.RawBytes("line one\r\nline two")
+		case 2:
+			values[i] = sql.RawBytes(strings.Repeat("X", width+4)) // truncated
+		case 3:
+			values[i] = sql.RawBytes{}
+		default:
+			values[i] = sql.RawBytes("2025-01-31T00:00:00Z")
+		}
+	}
+	return cols, values
+}
+
+func TestRowEncoderDoesNotAllocate(t *testing.T) {
+	for _, format := range []string{"fixed", "delimited"} {
+		cols, values := syntheticRow(50)
+		enc := NewRowEncoder(cols, format, "|")
+		line := enc.AppendRow(nil, values)
+		allocs := testing.AllocsPerRun(100, func() {
+			line = enc.AppendRow(line[:0], values)
+		})
+		if allocs > 0 {
+			t.Errorf("%s: AppendRow allocates %.1f times per row", format, allocs)
+		}
+	}
+}
+
+func BenchmarkRowEncoder(b *testing.B) {
+	for _, format := range []string{"fixed", "delimited"} {
+		for _, numCols := range benchColumnCounts {
+			b.Run(fmt.Sprintf("%s/%d", format, numCols), func(b *testing.B) {
+				cols, values := syntheticRow(numCols)
+				enc := NewRowEncoder(cols, format, "|")
+				line := enc.AppendRow(nil, values)
+				b.SetBytes(int64(len(line)))
+				b.ReportAllocs()
+				b.ResetTimer()
+				for range b.N {
+					line = enc.AppendRow(line[:0], values)
+				}
+			})
+		}
+	}
+}
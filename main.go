@@ -26,7 +26,11 @@ func init() {
 	slog.SetDefault(slog.New(slog.NewTextHandler(os.Stdout, &slog.HandlerOptions{
 		Level: slog.LevelInfo,
 	})))
+}
 
+// parseFlags reads and validates the command line. It runs from main rather than init
+// so that the package's tests can register their own flags.
+func parseFlags() {
 	flag.StringVar(appCfgFile, "appCfg", "", "Path to the main application configuration file")
 	flag.StringVar(runCfgFile, "runCfg", "", "Path to the extraction configuration file")
 	flag.StringVar(&mode, "mode", "", "Mode of operation: E - Extract, I - Insert")
@@ -51,6 +55,8 @@ func init() {
 }
 
 func main() {
+	parseFlags()
+
 	slog.Info("Starting claude_extract", "mode", mode, "app_config", *appCfgFile, "run_config", *runCfgFile)
 	
 	appCfg, err := loadMainConfig(*appCfgFile)
@@ -63,27 +69,6 @@ func main() {
 		slog.Error("Failed to load extraction config", "path", *runCfgFile, "error", err)
 		os.Exit(1)
 	}
-	
-	// Set chunked processing defaults
-	setChunkedDefaults(&runCfg)
-	if len(runCfg.ChunkedProcedures) > 0 {
-		slog.Info("Chunked procedures configured", 
-			"procedures", runCfg.ChunkedProcedures, 
-			"chunk_size", runCfg.ChunkSize)
-	}
-
-	// Load templates
-	templates := make(map[string][]ColumnConfig)
-	for _, proc := range runCfg.Procedures {
-		tmplPath := filepath.Join(runCfg.TemplatePath, fmt.Sprintf("%s.csv", proc))
-		cols, err := readColumnsFromCSV(tmplPath)
-		if err != nil {
-			slog.Error("Failed to read template", "procedure", proc, "path", tmplPath, "error", err)
-			os.Exit(1)
-		}
-		templates[proc] = cols
-	}
-	slog.Info("Templates loaded", "count", len(templates), "procedures", runCfg.Procedures)
 
 	connString := fmt.Sprintf(`user="%s" password="%s" connectString="%s:%d/%s"`,
 		appCfg.DBUser, appCfg.DBPassword, appCfg.DBHost, appCfg.DBPort, appCfg.DBSid)
@@ -103,14 +88,60 @@ func main() {
 		"port", appCfg.DBPort, 
 		"sid", appCfg.DBSid)
 
+	if _, err := runMode(mode, db, appCfg, runCfg); err != nil {
+		slog.Error("Run failed", "mode", mode, "error", err)
+		os.Exit(1)
+	}
+}
+
+// runMode runs extract (E) or insert (I) mode on db to completion and returns the final
+// connection pool stats. Invalid settings, templates or SOL files are returned as errors.
+func runMode(mode string, db *sql.DB, appCfg MainConfig, runCfg ExtractionConfig) (sql.DBStats, error) {
+	setMetricsDefaults(&appCfg)
+
+	// Set chunked processing defaults
+	setChunkedDefaults(&runCfg)
+	if len(runCfg.ChunkedProcedures) > 0 {
+		slog.Info("Chunked procedures configured", 
+			"procedures", runCfg.ChunkedProcedures, 
+			"chunk_size", runCfg.ChunkSize)
+	}
+	setOutputDefaults(&runCfg)
+	setFetchDefaults(&runCfg)
+	setInsertBatchDefaults(&runCfg)
+	if err := setCompressionDefaults(&runCfg); err != nil {
+		return sql.DBStats{}, fmt.Errorf("invalid compression settings: %w", err)
+	}
+	if runCfg.Compression != "" {
+		slog.Info("Output compression enabled",
+			"compression", runCfg.Compression,
+			"level", runCfg.CompressionLevel,
+			"block_kb", runCfg.CompressionBlockKB,
+			"workers", runCfg.CompressionWorkers)
+	}
+	if mode == "I" && runCfg.InsertBatchSize > 1 && !runCfg.UseProcLevelParallel {
+		slog.Warn("Batched procedure calls need procedure-level parallelism, calling one SOL at a time",
+			"insert_batch_size", runCfg.InsertBatchSize)
+	}
+
+	// Load templates
+	templates := make(map[string]*Template)
+	for _, proc := range runCfg.Procedures {
+		tmplPath := filepath.Join(runCfg.TemplatePath, fmt.Sprintf("%s.csv", proc))
+		tmpl, err := loadTemplate(tmplPath, &runCfg)
+		if err != nil {
+			return sql.DBStats{}, fmt.Errorf("failed to read template for %s from %s: %w", proc, tmplPath, err)
+		}
+		templates[proc] = tmpl
+	}
+	slog.Info("Templates loaded", "count", len(templates), "procedures", runCfg.Procedures)
+
 	procCount := len(runCfg.Procedures)
-	// Optimize connection pool for high concurrency with improved settings
-	maxConns := appCfg.Concurrency * procCount
-	if maxConns > 200 {
-		slog.Warn("Connection pool size may exceed database limits", 
-			"calculated_size", maxConns, 
-			"capped_size", 200)
-		maxConns = 200 // Cap at reasonable limit
+	// The pool bounds the scheduler's concurrency, which starts at appCfg.Concurrency and
+	// adapts to connection wait and query latency
+	maxConns := appCfg.MaxConnections
+	if maxConns <= 0 {
+		maxConns = min(max(appCfg.Concurrency, 1)*procCount, 200)
 	}
 	
 	// Enhanced connection pool configuration for better performance
@@ -127,20 +158,19 @@ func main() {
 
 	sols, err := readSols(appCfg.SolFilePath)
 	if err != nil {
-		slog.Error("Failed to read SOL IDs", "path", appCfg.SolFilePath, "error", err)
-		os.Exit(1)
+		return sql.DBStats{}, fmt.Errorf("failed to read SOL IDs from %s: %w", appCfg.SolFilePath, err)
 	}
 	slog.Info("SOL IDs loaded", "count", len(sols), "path", appCfg.SolFilePath)
 
 	// Scale buffer size based on expected load
 	bufferSize := max(1000, min(50000, len(sols)*len(runCfg.Procedures)))
 	procLogCh := make(chan ProcLog, bufferSize)
-	var summaryMu sync.Mutex
-	procSummary := make(map[string]ProcSummary)
+	procSummary := NewProcSummaries(runCfg.Procedures)
 
 	if (mode == "I" && !runCfg.RunInsertionParallel) || (mode == "E" && !runCfg.RunExtractionParallel) {
 		slog.Info("Running procedures sequentially", "reason", "parallel execution disabled")
 		appCfg.Concurrency = 1
+		maxConns = 1
 	}
 
 	var LogFile, LogFileSummary string
@@ -158,11 +188,21 @@ func main() {
 		"procedure_log", logFilePath, 
 		"summary_log", summaryFilePath)
 
-	go writeLog(logFilePath, procLogCh)
+	// Durations from the previous run order this run's tasks; read them before the log is truncated
+	history := loadTaskHistory(logFilePath)
+	logDone := make(chan struct{})
+	go func() {
+		defer close(logDone)
+		writeLog(logFilePath, procLogCh)
+	}()
 
 	sem := make(chan struct{}, appCfg.Concurrency)
 	var wg sync.WaitGroup
-	ctx := context.Background()
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	limiter := NewAIMDLimiter(appCfg.Concurrency, 1, maxConns, db.Stats)
+	go limiter.Run(ctx)
+	stopMetricsExport := startMetricsExport(ctx, appCfg)
 	totalSols := len(sols)
 	overallStart := time.Now()
 	var mu sync.Mutex
@@ -176,34 +216,28 @@ func main() {
 
 	if mode == "E" {
 		slog.Info("Starting extraction mode", "total_sols", totalSols)
-		for _, sol := range sols {
-			wg.Add(1)
-			sem <- struct{}{}
-			go func(solID string) {
-				defer wg.Done()
-				defer func() { <-sem }()
-				slog.Debug("Starting SOL extraction", "sol_id", solID)
-
-				runExtractionForSol(ctx, db, solID, &runCfg, templates, procLogCh, &summaryMu, procSummary)
-
-				mu.Lock()
-				completed++
-				if completed%100 == 0 || completed == totalSols {
-					elapsed := time.Since(overallStart)
-					estimatedTotal := time.Duration(float64(elapsed) / float64(completed) * float64(totalSols))
-					eta := estimatedTotal - elapsed
-					progress := float64(completed) * 100 / float64(totalSols)
-					slog.Info("Extraction progress", 
-						"completed", completed,
-						"total", totalSols,
-						"progress_percent", fmt.Sprintf("%.2f", progress),
-						"elapsed", elapsed.Round(time.Second).String(),
-						"eta", eta.Round(time.Second).String())
-				}
-				mu.Unlock()
-			}(sol)
+		var outputs map[string]*ProcOutput
+		if runCfg.DirectOutput {
+			// Sorted SOL order keeps the direct outputs identical to the merged spool files
+			slices.Sort(sols)
+			outputs, err = openProcOutputs(&runCfg)
+			if err != nil {
+				close(procLogCh)
+				<-logDone
+				stopMetricsExport()
+				return sql.DBStats{}, fmt.Errorf("failed to open procedure outputs in %s: %w", runCfg.SpoolOutputPath, err)
+			}
+			slog.Info("Direct output enabled",
+				"procedures", len(outputs),
+				"reorder_buffer_mb", runCfg.ReorderBufferMB)
+		}
+		if runCfg.SolBatchSize > 1 {
+			slog.Info("Batched extraction enabled", "sol_batch_size", runCfg.SolBatchSize)
+		}
+		runExtraction(ctx, db, sols, &runCfg, templates, outputs, procLogCh, procSummary, limiter, maxConns, history)
+		if outputs != nil && !closeProcOutputs(outputs, totalSols) {
+			slog.Error("Direct output incomplete", "path", runCfg.SpoolOutputPath)
 		}
-		wg.Wait()
 	} else if mode == "I" {
 		if runCfg.UseProcLevelParallel {
 			totalTasks := totalSols * len(runCfg.Procedures)
@@ -212,7 +246,7 @@ func main() {
 				"procedures", len(runCfg.Procedures),
 				"total_tasks", totalTasks,
 				"max_connections", maxConns,
-				"idle_connections", maxConns/2)
+				"initial_concurrency", limiter.Limit())
 			
 			// Monitor connection pool stats
 			go func() {
@@ -234,7 +268,7 @@ func main() {
 				}
 			}()
 			
-			runProceduresWithProcLevelParallelism(ctx, db, sols, &runCfg, procLogCh, &summaryMu, procSummary, appCfg.Concurrency)
+			runProceduresWithProcLevelParallelism(ctx, db, sols, &runCfg, procLogCh, procSummary, limiter, maxConns, history)
 			slog.Info("Completed all procedure-level tasks", "total_tasks", totalTasks)
 		} else {
 			slog.Info("Starting SOL-level parallel execution (legacy mode)", "total_sols", totalSols)
@@ -246,7 +280,7 @@ func main() {
 					defer func() { <-sem }()
 					slog.Debug("Starting SOL procedures", "sol_id", solID)
 
-					runProceduresForSol(ctx, db, solID, &runCfg, procLogCh, &summaryMu, procSummary)
+					runProceduresForSol(ctx, db, solID, &runCfg, procLogCh, procSummary)
 
 					mu.Lock()
 					completed++
@@ -269,12 +303,15 @@ func main() {
 		}
 	}
 	close(procLogCh)
+	<-logDone
 
 	slog.Info("Writing summary files", "summary_path", summaryFilePath)
-	writeSummary(summaryFilePath, procSummary)
-	if mode == "E" {
+	writeSummary(summaryFilePath, procSummary.Snapshot())
+	if mode == "E" && !runCfg.DirectOutput {
 		slog.Info("Merging extraction files")
-		mergeFiles(&runCfg)
+		if err := mergeFiles(&runCfg); err != nil {
+			slog.Error("Failed to merge extraction files", "error", err)
+		}
 	}
 	
 	// Clean up prepared statements
@@ -294,22 +331,31 @@ func main() {
 	
 	// Performance metrics summary
 	totalQueries, avgDuration, cacheHitRate, slowQueries := globalMetrics.GetStats()
-	totalRowsProcessed := globalMetrics.TotalRowsProcessed
-	totalBytesWritten := globalMetrics.TotalBytesWritten
+	totalRowsProcessed := globalMetrics.RowsProcessed()
+	totalBytesWritten := globalMetrics.BytesWritten()
 	totalDuration := time.Since(overallStart)
+	queryStats := globalMetrics.QueryLatency()
 	
 	slog.Info("Performance summary",
 		"total_queries", totalQueries,
 		"avg_query_time", avgDuration.Round(time.Millisecond).String(),
+		"p50_query_time", queryStats.P50.String(),
+		"p95_query_time", queryStats.P95.String(),
+		"p99_query_time", queryStats.P99.String(),
+		"max_query_time", queryStats.Max.String(),
 		"cache_hit_rate_percent", fmt.Sprintf("%.1f", cacheHitRate),
 		"slow_queries", slowQueries,
 		"rows_processed", totalRowsProcessed,
+		"rows_per_estimated_round_trip", fmt.Sprintf("%.1f", globalMetrics.RowsPerEstimatedRoundTrip()),
 		"bytes_written_mb", fmt.Sprintf("%.2f", float64(totalBytesWritten)/(1024*1024)),
 		"total_duration", totalDuration.Round(time.Second).String(),
 		"sols_processed", totalSols)
+	globalMetrics.logLatencySummary()
+	stopMetricsExport()
 	
 	slog.Info("Processing completed successfully", 
 		"mode", mode, 
 		"total_sols", totalSols, 
 		"duration", totalDuration.Round(time.Second).String())
+	return finalStats, nil
 }
@@ -0,0 +1,371 @@
+package main
+
+import (
+	"fmt"
+	"log/slog"
+	"math/bits"
+	"math/rand"
+	"slices"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// Instrumentation records latencies per procedure and phase in log-bucketed histograms
+// and totals in sharded counters. Recording is a few atomic adds on a randomly picked
+// shard, so workers never take a shared lock; readers merge the shards when reporting.
+
+// Phase is a step of a (SOL, procedure) task that gets its own latency histogram
+type Phase int
+
+const (
+	PhasePrepare Phase = iota // statement prepare or cache lookup
+	PhaseExecute              // execute round trip, including prefetched rows
+	PhaseFetch                // fetching and scanning the remaining rows
+	PhaseEncode               // encoding rows to the output format
+	PhaseWrite                // handing encoded rows to the output file
+	PhaseLog                  // queueing the procedure log record
+	PhaseTask                 // the whole task as run by the scheduler
+	numPhases
+)
+
+var phaseNames = [numPhases]string{"prepare", "execute", "fetch", "encode", "write", "log", "task"}
+
+func (p Phase) String() string {
+	return phaseNames[p]
+}
+
+// phaseSampleRate is how often per-row phases are timed: a clock read costs about as
+// much as encoding a row, so only every 64th row is timed and the total is scaled up
+const phaseSampleRate = 64
+
+// phaseSampler estimates the time a per-row phase took over a query from sampled rows
+type phaseSampler struct {
+	sampled time.Duration
+	samples int64
+}
+
+func (s *phaseSampler) add(d time.Duration) {
+	s.sampled += d
+	s.samples++
+}
+
+// total scales the sampled time to rows rows
+func (s *phaseSampler) total(rows int64) time.Duration {
+	if s.samples == 0 {
+		return 0
+	}
+	return time.Duration(float64(s.sampled) * float64(rows) / float64(s.samples))
+}
+
+// Histogram layout: values are microseconds, each power of two is split into 16 linear
+// sub-buckets (about 6% relative error), and values past 2^40us land in the last bucket
+const (
+	metricShards   = 8 // counter shards, a power of two
+	histShards     = 4 // histogram shards, a power of two
+	histSubBits    = 4
+	histSubBuckets = 1 << histSubBits
+	histMaxBits    = 40
+	histBuckets    = (histMaxBits - histSubBits + 1) * histSubBuckets
+)
+
+// shardIndex picks a shard; the global math/rand source is lock-free when unseeded
+func shardIndex(shards int) int {
+	return int(rand.Uint32()) & (shards - 1)
+}
+
+// ShardedCounter is an int64 counter spread over cache-line padded shards
+type ShardedCounter struct {
+	shards [metricShards]struct {
+		v atomic.Int64
+		_ [56]byte
+	}
+}
+
+func (c *ShardedCounter) Add(n int64) {
+	c.shards[shardIndex(metricShards)].v.Add(n)
+}
+
+func (c *ShardedCounter) Load() int64 {
+	var total int64
+	for i := range c.shards {
+		total += c.shards[i].v.Load()
+	}
+	return total
+}
+
+type histShard struct {
+	counts [histBuckets]atomic.Int64
+	sum    atomic.Int64 // microseconds
+	max    atomic.Int64 // microseconds
+}
+
+// Histogram is a lock-free log-bucketed latency histogram
+type Histogram struct {
+	shards [histShards]histShard
+}
+
+// histBucket maps a value to its bucket: values below 16 get exact buckets, larger ones
+// keep their top five significant bits
+func histBucket(v uint64) int {
+	if v < histSubBuckets {
+		return int(v)
+	}
+	n := bits.Len64(v)
+	if n > histMaxBits {
+		return histBuckets - 1
+	}
+	shift := n - histSubBits - 1
+	return (shift+1)*histSubBuckets + int(v>>shift) - histSubBuckets
+}
+
+// histBucketHigh returns the largest value that maps to bucket i
+func histBucketHigh(i int) uint64 {
+	if i < histSubBuckets {
+		return uint64(i)
+	}
+	shift := i/histSubBuckets - 1
+	low := uint64(histSubBuckets+i%histSubBuckets) << shift
+	return low + 1<<shift - 1
+}
+
+func (h *Histogram) Record(d time.Duration) {
+	us := max(d.Microseconds(), 0)
+	s := &h.shards[shardIndex(histShards)]
+	s.counts[histBucket(uint64(us))].Add(1)
+	s.sum.Add(us)
+	for {
+		m := s.max.Load()
+		if us <= m || s.max.CompareAndSwap(m, us) {
+			break
+		}
+	}
+}
+
+// HistogramStats summarizes a histogram; quantiles are bucket upper bounds capped at Max
+type HistogramStats struct {
+	Count int64
+	Sum   time.Duration
+	P50   time.Duration
+	P95   time.Duration
+	P99   time.Duration
+	Max   time.Duration
+}
+
+func (s HistogramStats) Mean() time.Duration {
+	if s.Count == 0 {
+		return 0
+	}
+	return s.Sum / time.Duration(s.Count)
+}
+
+// Stats merges the shards into a summary. Counts recorded while it runs may be partly
+// included, which only skews a live view by the in-flight samples.
+func (h *Histogram) Stats() HistogramStats {
+	var counts [histBuckets]int64
+	var stats HistogramStats
+	var maxUs int64
+	for i := range h.shards {
+		s := &h.shards[i]
+		for b := range counts {
+			counts[b] += s.counts[b].Load()
+		}
+		stats.Sum += time.Duration(s.sum.Load()) * time.Microsecond
+		maxUs = max(maxUs, s.max.Load())
+	}
+	for _, c := range counts {
+		stats.Count += c
+	}
+	stats.Max = time.Duration(maxUs) * time.Microsecond
+	if stats.Count == 0 {
+		return stats
+	}
+
+	quantile := func(q float64) time.Duration {
+		rank := int64(q * float64(stats.Count))
+		var seen int64
+		for b, c := range counts {
+			seen += c
+			if seen > rank {
+				if b == histBuckets-1 {
+					// The last bucket is unbounded; Max is the only bound it has
+					return stats.Max
+				}
+				return min(time.Duration(histBucketHigh(b))*time.Microsecond, stats.Max)
+			}
+		}
+		return stats.Max
+	}
+	stats.P50 = quantile(0.50)
+	stats.P95 = quantile(0.95)
+	stats.P99 = quantile(0.99)
+	return stats
+}
+
+// procMetrics holds a procedure's phase histograms, created on first use
+type procMetrics struct {
+	phases [numPhases]atomic.Pointer[Histogram]
+}
+
+func (p *procMetrics) histogram(phase Phase) *Histogram {
+	if h := p.phases[phase].Load(); h != nil {
+		return h
+	}
+	h := new(Histogram)
+	if p.phases[phase].CompareAndSwap(nil, h) {
+		return h
+	}
+	return p.phases[phase].Load()
+}
+
+// Performance metrics for monitoring
+type PerformanceMetrics struct {
+	queries             ShardedCounter
+	queryTime           ShardedCounter // nanoseconds
+	cacheHits           ShardedCounter
+	cacheMisses         ShardedCounter
+	rowsProcessed       ShardedCounter
+	bytesWritten        ShardedCounter
+	slowQueries         ShardedCounter // queries > 1 second
+	estimatedRoundTrips ShardedCounter // extraction round trips estimated from the configured fetch sizes
+
+	queryLatency Histogram // extraction queries of all procedures
+	procedures   sync.Map  // procedure name -> *procMetrics
+}
+
+func NewPerformanceMetrics() *PerformanceMetrics {
+	return &PerformanceMetrics{}
+}
+
+func (pm *PerformanceMetrics) procedure(proc string) *procMetrics {
+	if p, ok := pm.procedures.Load(proc); ok {
+		return p.(*procMetrics)
+	}
+	p, _ := pm.procedures.LoadOrStore(proc, &procMetrics{})
+	return p.(*procMetrics)
+}
+
+// RecordQuery records one extraction query from prepare to its last row
+func (pm *PerformanceMetrics) RecordQuery(duration time.Duration, rowCount int64, bytesWritten int64) {
+	pm.queries.Add(1)
+	pm.queryTime.Add(int64(duration))
+	pm.rowsProcessed.Add(rowCount)
+	pm.bytesWritten.Add(bytesWritten)
+	if duration > time.Second {
+		pm.slowQueries.Add(1)
+	}
+	pm.queryLatency.Record(duration)
+}
+
+// RecordPhase records the time a procedure spent in one phase
+func (pm *PerformanceMetrics) RecordPhase(proc string, phase Phase, d time.Duration) {
+	pm.procedure(proc).histogram(phase).Record(d)
+}
+
+// RecordEstimatedRoundTrips adds round trips derived from the prefetch and fetch array
+// sizes a query was configured with; they are not measured on the session
+func (pm *PerformanceMetrics) RecordEstimatedRoundTrips(roundTrips int64) {
+	pm.estimatedRoundTrips.Add(roundTrips)
+}
+
+// RowsPerEstimatedRoundTrip reports the average number of rows per estimated extraction
+// round trip, which shows how well the configured fetch sizes fit the rows returned
+func (pm *PerformanceMetrics) RowsPerEstimatedRoundTrip() float64 {
+	roundTrips := pm.estimatedRoundTrips.Load()
+	if roundTrips == 0 {
+		return 0
+	}
+	return float64(pm.rowsProcessed.Load()) / float64(roundTrips)
+}
+
+func (pm *PerformanceMetrics) RecordCacheHit() {
+	pm.cacheHits.Add(1)
+}
+
+func (pm *PerformanceMetrics) RecordCacheMiss() {
+	pm.cacheMisses.Add(1)
+}
+
+func (pm *PerformanceMetrics) RowsProcessed() int64 {
+	return pm.rowsProcessed.Load()
+}
+
+func (pm *PerformanceMetrics) BytesWritten() int64 {
+	return pm.bytesWritten.Load()
+}
+
+func (pm *PerformanceMetrics) GetStats() (int64, time.Duration, float64, int64) {
+	totalQueries := pm.queries.Load()
+	totalTime := pm.queryTime.Load()
+	cacheHits := pm.cacheHits.Load()
+	cacheMisses := pm.cacheMisses.Load()
+	slowQueries := pm.slowQueries.Load()
+
+	var avgDuration time.Duration
+	if totalQueries > 0 {
+		avgDuration = time.Duration(totalTime / totalQueries)
+	}
+
+	var cacheHitRate float64
+	if cacheHits+cacheMisses > 0 {
+		cacheHitRate = float64(cacheHits) / float64(cacheHits+cacheMisses) * 100
+	}
+
+	return totalQueries, avgDuration, cacheHitRate, slowQueries
+}
+
+// QueryLatency summarizes extraction query latency across all procedures
+func (pm *PerformanceMetrics) QueryLatency() HistogramStats {
+	return pm.queryLatency.Stats()
+}
+
+// Procedures lists the procedures with recorded phases, sorted
+func (pm *PerformanceMetrics) Procedures() []string {
+	var procs []string
+	pm.procedures.Range(func(key, _ any) bool {
+		procs = append(procs, key.(string))
+		return true
+	})
+	slices.Sort(procs)
+	return procs
+}
+
+// PhaseStats summarizes one procedure phase; ok is false if it was never recorded
+func (pm *PerformanceMetrics) PhaseStats(proc string, phase Phase) (HistogramStats, bool) {
+	p, ok := pm.procedures.Load(proc)
+	if !ok {
+		return HistogramStats{}, false
+	}
+	h := p.(*procMetrics).phases[phase].Load()
+	if h == nil {
+		return HistogramStats{}, false
+	}
+	return h.Stats(), true
+}
+
+// logLatencySummary logs the latency distribution of every recorded procedure phase
+func (pm *PerformanceMetrics) logLatencySummary() {
+	for _, proc := range pm.Procedures() {
+		for phase := Phase(0); phase < numPhases; phase++ {
+			stats, ok := pm.PhaseStats(proc, phase)
+			if !ok || stats.Count == 0 {
+				continue
+			}
+			slog.Info("Procedure latency",
+				"procedure", proc,
+				"phase", phase.String(),
+				"count", stats.Count,
+				"mean_ms", fmt.Sprintf("%.2f", msec(stats.Mean())),
+				"p50_ms", fmt.Sprintf("%.2f", msec(stats.P50)),
+				"p95_ms", fmt.Sprintf("%.2f", msec(stats.P95)),
+				"p99_ms", fmt.Sprintf("%.2f", msec(stats.P99)),
+				"max_ms", fmt.Sprintf("%.2f", msec(stats.Max)))
+		}
+	}
+}
+
+func msec(d time.Duration) float64 {
+	return float64(d) / float64(time.Millisecond)
+}
+
+var globalMetrics = NewPerformanceMetrics()
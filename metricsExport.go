@@ -0,0 +1,203 @@
+package main
+
+import (
+	"bufio"
+	"context"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"log/slog"
+	"net"
+	"net/http"
+	"os"
+	"path/filepath"
+	"strconv"
+	"time"
+)
+
+// MetricsSnapshot is the JSON form of globalMetrics written to metrics_snapshot_path
+type MetricsSnapshot struct {
+	Time                time.Time                             `json:"time"`
+	Queries             int64                                 `json:"queries"`
+	SlowQueries         int64                                 `json:"slow_queries"`
+	RowsProcessed       int64                                 `json:"rows_processed"`
+	BytesWritten        int64                                 `json:"bytes_written"`
+	EstimatedRoundTrips int64                                 `json:"estimated_round_trips"` // derived from the configured fetch sizes
+	CacheHits           int64                                 `json:"cache_hits"`
+	CacheMisses         int64                                 `json:"cache_misses"`
+	QueryLatency        LatencySnapshot                       `json:"query_latency"`
+	ProcedurePhases     map[string]map[string]LatencySnapshot `json:"procedure_phases"`
+}
+
+// LatencySnapshot is a histogram summary in milliseconds
+type LatencySnapshot struct {
+	Count  int64   `json:"count"`
+	MeanMs float64 `json:"mean_ms"`
+	P50Ms  float64 `json:"p50_ms"`
+	P95Ms  float64 `json:"p95_ms"`
+	P99Ms  float64 `json:"p99_ms"`
+	MaxMs  float64 `json:"max_ms"`
+}
+
+func latencySnapshot(s HistogramStats) LatencySnapshot {
+	return LatencySnapshot{
+		Count:  s.Count,
+		MeanMs: msec(s.Mean()),
+		P50Ms:  msec(s.P50),
+		P95Ms:  msec(s.P95),
+		P99Ms:  msec(s.P99),
+		MaxMs:  msec(s.Max),
+	}
+}
+
+func (pm *PerformanceMetrics) Snapshot() MetricsSnapshot {
+	snap := MetricsSnapshot{
+		Time:                time.Now(),
+		Queries:             pm.queries.Load(),
+		SlowQueries:         pm.slowQueries.Load(),
+		RowsProcessed:       pm.rowsProcessed.Load(),
+		BytesWritten:        pm.bytesWritten.Load(),
+		EstimatedRoundTrips: pm.estimatedRoundTrips.Load(),
+		CacheHits:           pm.cacheHits.Load(),
+		CacheMisses:         pm.cacheMisses.Load(),
+		QueryLatency:        latencySnapshot(pm.QueryLatency()),
+		ProcedurePhases:     make(map[string]map[string]LatencySnapshot),
+	}
+	for _, proc := range pm.Procedures() {
+		phases := make(map[string]LatencySnapshot)
+		for phase := Phase(0); phase < numPhases; phase++ {
+			if stats, ok := pm.PhaseStats(proc, phase); ok {
+				phases[phase.String()] = latencySnapshot(stats)
+			}
+		}
+		snap.ProcedurePhases[proc] = phases
+	}
+	return snap
+}
+
+// writeMetricsSnapshot replaces the snapshot file atomically so readers never see a partial one
+func writeMetricsSnapshot(path string, snap MetricsSnapshot) error {
+	data, err := json.MarshalIndent(snap, "", "  ")
+	if err != nil {
+		return err
+	}
+	tmp, err := os.CreateTemp(filepath.Dir(path), filepath.Base(path)+".*")
+	if err != nil {
+		return fmt.Errorf("failed to create metrics snapshot: %w", err)
+	}
+	if _, err := tmp.Write(data); err != nil {
+		tmp.Close()
+		os.Remove(tmp.Name())
+		return fmt.Errorf("failed to write metrics snapshot: %w", err)
+	}
+	if err := tmp.Close(); err != nil {
+		os.Remove(tmp.Name())
+		return fmt.Errorf("failed to write metrics snapshot: %w", err)
+	}
+	return os.Rename(tmp.Name(), path)
+}
+
+// writePrometheus writes globalMetrics in the Prometheus text exposition format
+func writePrometheus(w io.Writer, pm *PerformanceMetrics) {
+	counter := func(name, help string, value int64) {
+		fmt.Fprintf(w, "# HELP %s %s\n# TYPE %s counter\n%s %d\n", name, help, name, name, value)
+	}
+	counter("claude_extract_queries_total", "Extraction queries run.", pm.queries.Load())
+	counter("claude_extract_slow_queries_total", "Extraction queries slower than one second.", pm.slowQueries.Load())
+	counter("claude_extract_rows_total", "Rows extracted.", pm.rowsProcessed.Load())
+	counter("claude_extract_bytes_written_total", "Encoded bytes written.", pm.bytesWritten.Load())
+	counter("claude_extract_estimated_round_trips_total", "Extraction round trips estimated from the configured prefetch and fetch array sizes.", pm.estimatedRoundTrips.Load())
+	counter("claude_extract_stmt_cache_hits_total", "Prepared statement cache hits.", pm.cacheHits.Load())
+	counter("claude_extract_stmt_cache_misses_total", "Prepared statement cache misses.", pm.cacheMisses.Load())
+
+	summary := func(name, labels string, s HistogramStats) {
+		quantileLabels := labels
+		if quantileLabels != "" {
+			quantileLabels += ","
+		}
+		for _, q := range []struct {
+			quantile string
+			value    time.Duration
+		}{{"0.5", s.P50}, {"0.95", s.P95}, {"0.99", s.P99}, {"1", s.Max}} {
+			fmt.Fprintf(w, "%s{%squantile=%q} %s\n", name, quantileLabels, q.quantile, promSeconds(q.value))
+		}
+		if labels != "" {
+			labels = "{" + labels + "}"
+		}
+		fmt.Fprintf(w, "%s_sum%s %s\n", name, labels, promSeconds(s.Sum))
+		fmt.Fprintf(w, "%s_count%s %d\n", name, labels, s.Count)
+	}
+
+	fmt.Fprintf(w, "# HELP claude_extract_query_seconds Extraction query latency across procedures.\n# TYPE claude_extract_query_seconds summary\n")
+	summary("claude_extract_query_seconds", "", pm.QueryLatency())
+
+	fmt.Fprintf(w, "# HELP claude_extract_phase_seconds Latency per procedure and phase.\n# TYPE claude_extract_phase_seconds summary\n")
+	for _, proc := range pm.Procedures() {
+		for phase := Phase(0); phase < numPhases; phase++ {
+			if stats, ok := pm.PhaseStats(proc, phase); ok {
+				summary("claude_extract_phase_seconds", fmt.Sprintf("procedure=%q,phase=%q", proc, phase.String()), stats)
+			}
+		}
+	}
+}
+
+func promSeconds(d time.Duration) string {
+	return strconv.FormatFloat(d.Seconds(), 'g', -1, 64)
+}
+
+// startMetricsExport serves /metrics on 127.0.0.1:metrics_port and writes the JSON snapshot
+// every metrics_snapshot_seconds, both only when configured. The returned function stops
+// the export and writes a final snapshot.
+func startMetricsExport(ctx context.Context, cfg MainConfig) func() {
+	ctx, cancel := context.WithCancel(ctx)
+	var server *http.Server
+	if cfg.MetricsPort > 0 {
+		addr := net.JoinHostPort("127.0.0.1", strconv.Itoa(cfg.MetricsPort))
+		mux := http.NewServeMux()
+		mux.HandleFunc("/metrics", func(w http.ResponseWriter, r *http.Request) {
+			w.Header().Set("Content-Type", "text/plain; version=0.0.4")
+			bw := bufio.NewWriter(w)
+			writePrometheus(bw, globalMetrics)
+			bw.Flush()
+		})
+		server = &http.Server{Addr: addr, Handler: mux, ReadHeaderTimeout: 5 * time.Second}
+		go func() {
+			if err := server.ListenAndServe(); err != nil && !errors.Is(err, http.ErrServerClosed) {
+				slog.Error("Metrics endpoint failed", "address", addr, "error", err)
+			}
+		}()
+		slog.Info("Metrics endpoint started", "url", "http://"+addr+"/metrics")
+	}
+
+	if cfg.MetricsSnapshotPath != "" {
+		interval := time.Duration(cfg.MetricsSnapshotSeconds) * time.Second
+		go func() {
+			ticker := time.NewTicker(interval)
+			defer ticker.Stop()
+			for {
+				select {
+				case <-ticker.C:
+					if err := writeMetricsSnapshot(cfg.MetricsSnapshotPath, globalMetrics.Snapshot()); err != nil {
+						slog.Warn("Failed to write metrics snapshot", "path", cfg.MetricsSnapshotPath, "error", err)
+					}
+				case <-ctx.Done():
+					return
+				}
+			}
+		}()
+		slog.Info("Metrics snapshots enabled", "path", cfg.MetricsSnapshotPath, "interval", interval.String())
+	}
+
+	return func() {
+		cancel()
+		if server != nil {
+			server.Close()
+		}
+		if cfg.MetricsSnapshotPath != "" {
+			if err := writeMetricsSnapshot(cfg.MetricsSnapshotPath, globalMetrics.Snapshot()); err != nil {
+				slog.Warn("Failed to write metrics snapshot", "path", cfg.MetricsSnapshotPath, "error", err)
+			}
+		}
+	}
+}
@@ -0,0 +1,141 @@
+package main
+
+import (
+	"math"
+	"testing"
+	"time"
+)
+
+// histLastValue is the largest value the histogram resolves; larger ones share the last bucket
+const histLastValue = uint64(1)<<histMaxBits - 1
+
+func TestHistBucketBounds(t *testing.T) {
+	tests := []struct {
+		name   string
+		v      uint64
+		bucket int // -1 to only check the bounds
+	}{
+		{"zero", 0, 0},
+		{"one", 1, 1},
+		{"last exact", histSubBuckets - 1, histSubBuckets - 1},
+		{"first sub-bucketed", histSubBuckets, histSubBuckets},
+		{"two sub-bucket widths", 2 * histSubBuckets, 2 * histSubBuckets},
+		{"odd", 1000, -1},
+		{"one second", uint64(time.Second / time.Microsecond), -1},
+		{"one hour", uint64(time.Hour / time.Microsecond), -1},
+		{"below power of two", 1<<30 - 1, -1},
+		{"power of two", 1 << 30, -1},
+		{"last resolved", histLastValue, histBuckets - 1},
+		{"first overflow", histLastValue + 1, histBuckets - 1},
+		{"max duration", uint64(time.Duration(math.MaxInt64) / time.Microsecond), histBuckets - 1},
+		{"max uint64", math.MaxUint64, histBuckets - 1},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			b := histBucket(tt.v)
+			if b < 0 || b >= histBuckets {
+				t.Fatalf("histBucket(%d) = %d, out of range", tt.v, b)
+			}
+			if tt.bucket >= 0 && b != tt.bucket {
+				t.Errorf("histBucket(%d) = %d, want %d", tt.v, b, tt.bucket)
+			}
+			if tt.v > histLastValue {
+				return
+			}
+			high := histBucketHigh(b)
+			if high < tt.v {
+				t.Errorf("value %d above its bucket %d's high %d", tt.v, b, high)
+			}
+			if b > 0 && histBucketHigh(b-1) >= tt.v {
+				t.Errorf("value %d not above bucket %d's high %d", tt.v, b-1, histBucketHigh(b-1))
+			}
+			// Reporting the bucket high overstates a value by less than one sub-bucket
+			if relErr := float64(high-tt.v) / float64(max(tt.v, 1)); relErr >= 1.0/histSubBuckets {
+				t.Errorf("value %d reported as %d, relative error %.4f", tt.v, high, relErr)
+			}
+		})
+	}
+}
+
+func TestHistBucketHighMonotonic(t *testing.T) {
+	if histBucketHigh(histBuckets-1) != histLastValue {
+		t.Errorf("last bucket high %d, want %d", histBucketHigh(histBuckets-1), histLastValue)
+	}
+	for i := 1; i < histBuckets; i++ {
+		low, high := histBucketHigh(i-1)+1, histBucketHigh(i)
+		if high < low {
+			t.Fatalf("bucket %d high %d below bucket %d's %d", i, high, i-1, low-1)
+		}
+		// Both ends of every bucket map back to it
+		if histBucket(low) != i || histBucket(high) != i {
+			t.Fatalf("bucket %d spans %d-%d, which map to %d and %d", i, low, high, histBucket(low), histBucket(high))
+		}
+	}
+}
+
+func TestHistogramRecordEdges(t *testing.T) {
+	tests := []struct {
+		name string
+		d    time.Duration
+		max  time.Duration
+	}{
+		{"zero", 0, 0},
+		{"one nanosecond", time.Nanosecond, 0},
+		{"negative", -time.Second, 0},
+		{"one microsecond", time.Microsecond, time.Microsecond},
+		{"max duration", math.MaxInt64, time.Duration(math.MaxInt64) / time.Microsecond * time.Microsecond},
+	}
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			var h Histogram
+			h.Record(tt.d)
+			s := h.Stats()
+			if s.Count != 1 || s.Max != tt.max {
+				t.Errorf("count %d max %v, want 1 and %v", s.Count, s.Max, tt.max)
+			}
+			if s.P50 != tt.max || s.P99 != tt.max {
+				t.Errorf("p50 %v p99 %v, want both %v", s.P50, s.P99, tt.max)
+			}
+		})
+	}
+}
+
+func TestHistogramQuantiles(t *testing.T) {
+	var h Histogram
+	for us := 1; us <= 10000; us++ {
+		h.Record(time.Duration(us) * time.Microsecond)
+	}
+	s := h.Stats()
+	if s.Count != 10000 || s.Max != 10*time.Millisecond {
+		t.Fatalf("count %d max %v, want 10000 and 10ms", s.Count, s.Max)
+	}
+	if want := time.Duration(10000*10001/2) * time.Microsecond; s.Sum != want {
+		t.Errorf("sum %v, want %v", s.Sum, want)
+	}
+	for _, q := range []struct {
+		name string
+		got  time.Duration
+		want time.Duration
+	}{
+		{"p50", s.P50, 5000 * time.Microsecond},
+		{"p95", s.P95, 9500 * time.Microsecond},
+		{"p99", s.P99, 9900 * time.Microsecond},
+	} {
+		if q.got < q.want || float64(q.got-q.want)/float64(q.want) >= 1.0/histSubBuckets {
+			t.Errorf("%s = %v, want %v within one sub-bucket above", q.name, q.got, q.want)
+		}
+	}
+}
+
+func TestPhaseSamplerScalesToRows(t *testing.T) {
+	var s phaseSampler
+	if s.total(1000) != 0 {
+		t.Errorf("unsampled total %v, want 0", s.total(1000))
+	}
+	for range 4 {
+		s.add(100 * time.Nanosecond)
+	}
+	if got := s.total(4 * phaseSampleRate); got != 400*phaseSampleRate*time.Nanosecond {
+		t.Errorf("total %v, want %v", got, 400*phaseSampleRate*time.Nanosecond)
+	}
+}
@@ -0,0 +1,214 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"database/sql/driver"
+	"errors"
+	"fmt"
+	"io"
+	"sync"
+	"time"
+
+	"github.com/godror/godror"
+)
+
+// Native fetch runs the extraction query on the driver connection underneath database/sql.
+// godror still fetches fetch_array_size rows per round trip into its ODPI-C buffers, but
+// each row is read with driver Rows.Next into a reused value slice and formatted straight
+// into the output line, skipping sql.Rows' per-row locking, Scan's conversions and the
+// copy through sql.RawBytes. godror's Rows.Next still builds a Go value per cell (a
+// string, godror.Number or time.Time), so the per-cell allocations of the driver remain.
+// It is enabled per procedure with native_fetch_procedures.
+
+// errNativeFetchUnsupported means the driver connection lacks the interfaces native fetch
+// needs; extractData then falls back to database/sql before any row is read
+var errNativeFetchUnsupported = errors.New("driver does not support native fetch")
+
+// rowSource yields a query's rows and encodes the current one
+type rowSource interface {
+	Next() bool
+	AppendRow(enc *RowEncoder, dst []byte) []byte
+	Err() error
+}
+
+// sqlRowSource scans database/sql rows into reusable raw buffers
+type sqlRowSource struct {
+	rows     *sql.Rows
+	values   []sql.RawBytes
+	scanArgs []interface{}
+	err      error
+}
+
+func newSQLRowSource(rows *sql.Rows, numCols int) *sqlRowSource {
+	values := rawValuesPool.Get().([]sql.RawBytes)
+	scanArgs := scanArgsPool.Get().([]interface{})
+	if cap(values) < numCols {
+		values = make([]sql.RawBytes, numCols)
+	} else {
+		values = values[:numCols]
+	}
+	if cap(scanArgs) < numCols {
+		scanArgs = make([]interface{}, numCols)
+	} else {
+		scanArgs = scanArgs[:numCols]
+	}
+	for i := range values {
+		scanArgs[i] = &values[i]
+	}
+	return &sqlRowSource{rows: rows, values: values, scanArgs: scanArgs}
+}
+
+func (s *sqlRowSource) Next() bool {
+	if !s.rows.Next() {
+		return false
+	}
+	if err := s.rows.Scan(s.scanArgs...); err != nil {
+		s.err = err
+		return false
+	}
+	return true
+}
+
+func (s *sqlRowSource) AppendRow(enc *RowEncoder, dst []byte) []byte {
+	return enc.AppendRow(dst, s.values)
+}
+
+func (s *sqlRowSource) Err() error {
+	if s.err != nil {
+		return s.err
+	}
+	return s.rows.Err()
+}
+
+// Close closes the rows and returns the scan buffers to their pools
+func (s *sqlRowSource) Close() {
+	s.rows.Close()
+	clear(s.values)
+	rawValuesPool.Put(s.values[:0])
+	clear(s.scanArgs)
+	scanArgsPool.Put(s.scanArgs[:0])
+}
+
+// driverValuesPool holds reusable destination slices for driver Rows.Next
+var driverValuesPool = sync.Pool{
+	New: func() interface{} {
+		return make([]driver.Value, 0, 50)
+	},
+}
+
+// nativeRowSource reads driver rows into a reused value slice
+type nativeRowSource struct {
+	rows   driver.Rows
+	values []driver.Value
+	err    error
+}
+
+func (s *nativeRowSource) Next() bool {
+	if s.err != nil {
+		return false
+	}
+	if err := s.rows.Next(s.values); err != nil {
+		if err != io.EOF {
+			s.err = err
+		}
+		return false
+	}
+	return true
+}
+
+func (s *nativeRowSource) AppendRow(enc *RowEncoder, dst []byte) []byte {
+	return enc.AppendValues(dst, s.values)
+}
+
+func (s *nativeRowSource) Err() error {
+	return s.err
+}
+
+// querySQL runs the query through the statement cache and database/sql and hands its rows to consume
+func querySQL(ctx context.Context, db *sql.DB, procName, query string, tmpl *Template, args []interface{}, consume func(rowSource) error) error {
+	prepareStart := time.Now()
+	stmt, err := globalStmtCache.GetOrPrepare(db, query)
+	if err != nil {
+		return fmt.Errorf("failed to prepare statement: %w", err)
+	}
+	execStart := time.Now()
+	globalMetrics.RecordPhase(procName, PhasePrepare, execStart.Sub(prepareStart))
+
+	queryArgs := make([]interface{}, 0, len(args)+2)
+	queryArgs = append(queryArgs, godror.FetchArraySize(tmpl.FetchArraySize), godror.PrefetchCount(tmpl.PrefetchCount))
+	queryArgs = append(queryArgs, args...)
+	rows, err := stmt.QueryContext(ctx, queryArgs...)
+	if err != nil {
+		return fmt.Errorf("query failed: %w", err)
+	}
+	globalMetrics.RecordPhase(procName, PhaseExecute, time.Since(execStart))
+
+	src := newSQLRowSource(rows, len(tmpl.Columns))
+	defer src.Close()
+	return consume(src)
+}
+
+// queryNative runs the query on a pooled connection's driver connection and hands its rows
+// to consume, which must finish with them before returning. It returns
+// errNativeFetchUnsupported, having read nothing, if the driver lacks the interfaces.
+func queryNative(ctx context.Context, db *sql.DB, procName, query string, tmpl *Template, args []interface{}, consume func(rowSource) error) error {
+	conn, err := db.Conn(ctx)
+	if err != nil {
+		return fmt.Errorf("failed to get connection: %w", err)
+	}
+	defer conn.Close()
+
+	return conn.Raw(func(driverConn any) error {
+		preparer, ok := driverConn.(driver.ConnPrepareContext)
+		if !ok {
+			return errNativeFetchUnsupported
+		}
+
+		// godror keeps an OCI statement cache per connection, so preparing again is a cache lookup
+		prepareStart := time.Now()
+		stmt, err := preparer.PrepareContext(ctx, query)
+		if err != nil {
+			return fmt.Errorf("failed to prepare statement: %w", err)
+		}
+		defer stmt.Close()
+		queryer, ok := stmt.(driver.StmtQueryContext)
+		if !ok {
+			return errNativeFetchUnsupported
+		}
+		execStart := time.Now()
+		globalMetrics.RecordPhase(procName, PhasePrepare, execStart.Sub(prepareStart))
+
+		// Options are applied by the statement's CheckNamedValue, as database/sql would do
+		namedArgs := make([]driver.NamedValue, 0, len(args))
+		checker, _ := stmt.(driver.NamedValueChecker)
+		for _, opt := range []godror.Option{godror.FetchArraySize(tmpl.FetchArraySize), godror.PrefetchCount(tmpl.PrefetchCount)} {
+			if checker != nil {
+				checker.CheckNamedValue(&driver.NamedValue{Value: opt})
+			}
+		}
+		for i, arg := range args {
+			namedArgs = append(namedArgs, driver.NamedValue{Ordinal: i + 1, Value: arg})
+		}
+
+		rows, err := queryer.QueryContext(ctx, namedArgs)
+		if err != nil {
+			return fmt.Errorf("query failed: %w", err)
+		}
+		defer rows.Close()
+		globalMetrics.RecordPhase(procName, PhaseExecute, time.Since(execStart))
+
+		numCols := len(rows.Columns())
+		values := driverValuesPool.Get().([]driver.Value)
+		if cap(values) < numCols {
+			values = make([]driver.Value, numCols)
+		} else {
+			values = values[:numCols]
+		}
+		defer func() {
+			clear(values)
+			driverValuesPool.Put(values[:0])
+		}()
+		return consume(&nativeRowSource{rows: rows, values: values})
+	})
+}
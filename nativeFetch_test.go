@@ -0,0 +1,120 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"fmt"
+	"runtime"
+	"strings"
+	"testing"
+)
+
+// benchFetchRows is the number of rows each fetch benchmark query returns
+const benchFetchRows = 10000
+
+func TestNativeFetchMatchesSQL(t *testing.T) {
+	db, err := sql.Open(syntheticDriverName, "")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+	defer globalStmtCache.Close()
+	const table = "P_FETCH"
+	profile := SyntheticProcedure{RowsMin: 200, Columns: 50}
+	setSyntheticDB(SyntheticDB{Procedures: map[string]SyntheticProcedure{table: profile}})
+
+	cols := syntheticColumns(profile)
+	cfg := &ExtractionConfig{Format: "fixed", FetchBufferKB: 512}
+	fetchArraySize, prefetchCount := fetchSizes(cols, cfg)
+	tmpl := &Template{Columns: cols, Encoder: NewRowEncoder(cols, cfg.Format, ""), FetchArraySize: fetchArraySize, PrefetchCount: prefetchCount}
+	colNames := make([]string, len(cols))
+	for i, col := range cols {
+		colNames[i] = col.Name
+	}
+	query := fmt.Sprintf("SELECT %s FROM %s WHERE SOL_ID = :1", strings.Join(colNames, ", "), table)
+
+	output := func(run func(context.Context, *sql.DB, string, string, *Template, []interface{}, func(rowSource) error) error) string {
+		var out []byte
+		err := run(context.Background(), db, table, query, tmpl, []interface{}{"SOL-1"}, func(src rowSource) error {
+			for src.Next() {
+				out = src.AppendRow(tmpl.Encoder, out)
+			}
+			return src.Err()
+		})
+		if err != nil {
+			t.Fatal(err)
+		}
+		return string(out)
+	}
+	want := output(querySQL)
+	if want == "" {
+		t.Fatal("no rows encoded")
+	}
+	if got := output(queryNative); got != want {
+		t.Errorf("native fetch encodes %d bytes that differ from database/sql's %d", len(got), len(want))
+	}
+}
+
+// BenchmarkFetch runs the extraction query against the synthetic database through
+// database/sql and native fetch, encoding every row; one op is one query of benchFetchRows
+// rows. The synthetic driver reuses its cell values, so allocs/row counts the extractor's
+// own allocations and none of godror's; measure against Oracle to see the driver's share.
+func BenchmarkFetch(b *testing.B) {
+	for _, numCols := range benchColumnCounts {
+		for _, path := range []string{"sql", "native"} {
+			b.Run(fmt.Sprintf("%s/%d", path, numCols), func(b *testing.B) {
+				benchmarkFetch(b, path == "native", numCols)
+			})
+		}
+	}
+}
+
+func benchmarkFetch(b *testing.B, native bool, numCols int) {
+	db, err := sql.Open(syntheticDriverName, "")
+	if err != nil {
+		b.Fatal(err)
+	}
+	defer db.Close()
+	defer globalStmtCache.Close()
+	table := fmt.Sprintf("BENCH_FETCH_%d", numCols)
+	profile := SyntheticProcedure{RowsMin: benchFetchRows, Columns: numCols}
+	setSyntheticDB(SyntheticDB{Procedures: map[string]SyntheticProcedure{table: profile}})
+
+	cols := syntheticColumns(profile)
+	cfg := &ExtractionConfig{Format: "fixed", FetchBufferKB: 512}
+	fetchArraySize, prefetchCount := fetchSizes(cols, cfg)
+	tmpl := &Template{Columns: cols, Encoder: NewRowEncoder(cols, cfg.Format, ""), FetchArraySize: fetchArraySize, PrefetchCount: prefetchCount}
+	colNames := make([]string, len(cols))
+	for i, col := range cols {
+		colNames[i] = col.Name
+	}
+	query := fmt.Sprintf("SELECT %s FROM %s WHERE SOL_ID = :1", strings.Join(colNames, ", "), table)
+	args := []interface{}{"SOL-1"}
+
+	var line []byte
+	consume := func(src rowSource) error {
+		for src.Next() {
+			line = src.AppendRow(tmpl.Encoder, line[:0])
+		}
+		return src.Err()
+	}
+	run := queryNative
+	if !native {
+		run = querySQL
+	}
+	b.ReportAllocs()
+	var before, after runtime.MemStats
+	runtime.ReadMemStats(&before)
+	b.ResetTimer()
+	for range b.N {
+		if err := run(context.Background(), db, "BENCH", query, tmpl, args, consume); err != nil {
+			b.Fatal(err)
+		}
+	}
+	b.StopTimer()
+	runtime.ReadMemStats(&after)
+
+	rows := float64(b.N) * benchFetchRows
+	b.ReportMetric(rows/b.Elapsed().Seconds(), "rows/s")
+	b.ReportMetric(float64(after.Mallocs-before.Mallocs)/rows, "allocs/row")
+}
@@ -0,0 +1,247 @@
+package main
+
+import (
+	"bufio"
+	"fmt"
+	"io"
+	"log/slog"
+	"os"
+	"path/filepath"
+	"sync"
+)
+
+// OutputFile is a final extract file. It is written through a pooled buffer, or with
+// compression = "gzip" as parallel compressed blocks to <path>.gz plus a <path>.gz.idx
+// block index.
+type OutputFile struct {
+	Path   string
+	file   *os.File
+	buf    *bufio.Writer
+	blocks *BlockWriter
+}
+
+// outputWriterPool reuses the buffers of plain output files
+var outputWriterPool = sync.Pool{
+	New: func() interface{} {
+		return bufio.NewWriterSize(nil, 256*1024)
+	},
+}
+
+func createOutputFile(path string, cfg *ExtractionConfig) (*OutputFile, error) {
+	if cfg.Compression == compressionGzip {
+		path += ".gz"
+	}
+	file, err := os.Create(path)
+	if err != nil {
+		return nil, fmt.Errorf("failed to create output file %s: %w", path, err)
+	}
+	f := &OutputFile{Path: path, file: file}
+	if cfg.Compression == compressionGzip {
+		f.blocks = NewBlockWriter(file, cfg.CompressionLevel, cfg.CompressionBlockKB*1024, cfg.CompressionWorkers)
+	} else {
+		f.buf = outputWriterPool.Get().(*bufio.Writer)
+		f.buf.Reset(file)
+	}
+	return f, nil
+}
+
+func (f *OutputFile) Write(p []byte) (int, error) {
+	if f.blocks != nil {
+		return f.blocks.Write(p)
+	}
+	return f.buf.Write(p)
+}
+
+func (f *OutputFile) ReadFrom(r io.Reader) (int64, error) {
+	if f.blocks != nil {
+		return f.blocks.ReadFrom(r)
+	}
+	return f.buf.ReadFrom(r)
+}
+
+// Compressed reports the compressed size, or -1 for a plain file
+func (f *OutputFile) Compressed() int64 {
+	if f.blocks == nil {
+		return -1
+	}
+	return f.blocks.Written()
+}
+
+// Close flushes the file, writes the block index of a compressed file and closes it
+func (f *OutputFile) Close() error {
+	var err error
+	if f.blocks != nil {
+		if err = f.blocks.Close(); err == nil {
+			err = writeBlockIndex(f.Path+".idx", f.blocks.index)
+		}
+	} else {
+		err = f.buf.Flush()
+		f.buf.Reset(nil)
+		outputWriterPool.Put(f.buf)
+	}
+	if err != nil {
+		f.file.Close()
+		return fmt.Errorf("failed to write output file %s: %w", f.Path, err)
+	}
+	if err := f.file.Close(); err != nil {
+		return fmt.Errorf("failed to close output file %s: %w", f.Path, err)
+	}
+	return nil
+}
+
+// ProcOutput writes a procedure's final <proc>.txt directly, replacing the per-SOL
+// spool files and the end-of-run merge. Every SOL commits exactly one segment tagged
+// with its position in the run, and segments are written in that order through a
+// reorder buffer bounded to maxPending bytes.
+type ProcOutput struct {
+	Procedure string
+	out       *OutputFile
+
+	mu           sync.Mutex
+	advanced     *sync.Cond
+	next         int
+	pending      map[int]*[]byte
+	pendingBytes int
+	maxPending   int
+	written      int64
+	err          error
+}
+
+// segmentPool reuses SOL segment buffers between commits
+var segmentPool = sync.Pool{
+	New: func() interface{} {
+		b := make([]byte, 0, 64*1024)
+		return &b
+	},
+}
+
+// Segments that grew past this are dropped instead of pooled so one large SOL
+// does not pin its memory for the rest of the run
+const maxPooledSegment = 4 * 1024 * 1024
+
+func getSegment() *[]byte {
+	return segmentPool.Get().(*[]byte)
+}
+
+func putSegment(segment *[]byte) {
+	if cap(*segment) > maxPooledSegment {
+		return
+	}
+	*segment = (*segment)[:0]
+	segmentPool.Put(segment)
+}
+
+func NewProcOutput(path, procedure string, maxPending int, cfg *ExtractionConfig) (*ProcOutput, error) {
+	out, err := createOutputFile(path, cfg)
+	if err != nil {
+		return nil, err
+	}
+	o := &ProcOutput{
+		Procedure:  procedure,
+		out:        out,
+		pending:    make(map[int]*[]byte),
+		maxPending: maxPending,
+	}
+	o.advanced = sync.NewCond(&o.mu)
+	return o, nil
+}
+
+// Commit hands over the encoded rows of the SOL at position seq; an empty segment
+// still advances the output. Out-of-order segments wait while the reorder buffer is
+// full, but the segment the writer is waiting for never does, so progress is guaranteed
+// as long as SOLs are started in sequence order. Commit takes ownership of segment.
+func (o *ProcOutput) Commit(seq int, segment *[]byte) {
+	o.mu.Lock()
+	defer o.mu.Unlock()
+
+	for seq != o.next && o.pendingBytes+len(*segment) > o.maxPending {
+		o.advanced.Wait()
+	}
+	if seq != o.next {
+		o.pending[seq] = segment
+		o.pendingBytes += len(*segment)
+		return
+	}
+
+	o.write(segment)
+	o.next++
+	for {
+		segment, ok := o.pending[o.next]
+		if !ok {
+			break
+		}
+		delete(o.pending, o.next)
+		o.pendingBytes -= len(*segment)
+		o.write(segment)
+		o.next++
+	}
+	o.advanced.Broadcast()
+}
+
+// write appends a segment to the file; the first error is kept and reported by Close
+func (o *ProcOutput) write(segment *[]byte) {
+	if o.err == nil {
+		n, err := o.out.Write(*segment)
+		o.written += int64(n)
+		if err != nil {
+			o.err = fmt.Errorf("failed to write output file %s: %w", o.out.Path, err)
+		}
+	}
+	putSegment(segment)
+}
+
+// Close flushes the output and checks that all expected segments were committed
+func (o *ProcOutput) Close(expectedSegments int) error {
+	o.mu.Lock()
+	defer o.mu.Unlock()
+
+	if err := o.out.Close(); err != nil && o.err == nil {
+		o.err = err
+	}
+	if o.next != expectedSegments && o.err == nil {
+		o.err = fmt.Errorf("output file %s is incomplete: wrote %d of %d SOL segments (%d pending)",
+			o.out.Path, o.next, expectedSegments, len(o.pending))
+	}
+	attrs := []any{
+		"procedure", o.Procedure,
+		"output_file", o.out.Path,
+		"segments", o.next,
+		"bytes_written_mb", fmt.Sprintf("%.2f", float64(o.written)/(1024*1024)),
+	}
+	if compressed := o.out.Compressed(); compressed >= 0 {
+		attrs = append(attrs, "compressed_mb", fmt.Sprintf("%.2f", float64(compressed)/(1024*1024)))
+	}
+	slog.Info("Output completed", attrs...)
+	return o.err
+}
+
+// openProcOutputs creates the direct output writers for all non-chunked procedures
+func openProcOutputs(cfg *ExtractionConfig) (map[string]*ProcOutput, error) {
+	outputs := make(map[string]*ProcOutput)
+	maxPending := cfg.ReorderBufferMB * 1024 * 1024
+	for _, proc := range cfg.Procedures {
+		if isChunkedProcedure(proc, cfg.ChunkedProcedures) {
+			continue
+		}
+		path := filepath.Join(cfg.SpoolOutputPath, fmt.Sprintf("%s.txt", proc))
+		out, err := NewProcOutput(path, proc, maxPending, cfg)
+		if err != nil {
+			closeProcOutputs(outputs, 0)
+			return nil, err
+		}
+		outputs[proc] = out
+	}
+	return outputs, nil
+}
+
+// closeProcOutputs closes every output, logging failures, and reports whether all succeeded
+func closeProcOutputs(outputs map[string]*ProcOutput, expectedSegments int) bool {
+	ok := true
+	for _, out := range outputs {
+		if err := out.Close(expectedSegments); err != nil {
+			slog.Error("Failed to complete procedure output", "procedure", out.Procedure, "error", err)
+			ok = false
+		}
+	}
+	return ok
+}
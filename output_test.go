@@ -0,0 +1,128 @@
+package main
+
+import (
+	"fmt"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+)
+
+func newTestProcOutput(t *testing.T, maxPending int) (*ProcOutput, string) {
+	t.Helper()
+	path := filepath.Join(t.TempDir(), "P_TEST.txt")
+	out, err := NewProcOutput(path, "P_TEST", maxPending, &ExtractionConfig{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	return out, path
+}
+
+func testSegment(s string) *[]byte {
+	segment := getSegment()
+	*segment = append(*segment, s...)
+	return segment
+}
+
+func TestProcOutputCommitsOutOfOrder(t *testing.T) {
+	const segments = 500
+	out, path := newTestProcOutput(t, 1<<20)
+
+	var want strings.Builder
+	for seq := range segments {
+		fmt.Fprintf(&want, "row %d\n", seq)
+	}
+	order := rand.New(rand.NewSource(1)).Perm(segments)
+	var wg sync.WaitGroup
+	for _, seq := range order {
+		wg.Add(1)
+		go func(seq int) {
+			defer wg.Done()
+			out.Commit(seq, testSegment(fmt.Sprintf("row %d\n", seq)))
+		}(seq)
+	}
+	wg.Wait()
+	if err := out.Close(segments); err != nil {
+		t.Fatal(err)
+	}
+
+	got, err := os.ReadFile(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if string(got) != want.String() {
+		t.Errorf("output is not in sequence order:\n%.200s", got)
+	}
+}
+
+func TestProcOutputEmptySegmentsAdvance(t *testing.T) {
+	out, path := newTestProcOutput(t, 1<<20)
+	out.Commit(2, testSegment("c\n"))
+	out.Commit(1, testSegment(""))
+	out.Commit(0, testSegment("a\n"))
+	if err := out.Close(3); err != nil {
+		t.Fatal(err)
+	}
+	got, _ := os.ReadFile(path)
+	if string(got) != "a\nc\n" {
+		t.Errorf("got %q, want %q", got, "a\nc\n")
+	}
+}
+
+func TestProcOutputReorderBufferBound(t *testing.T) {
+	const maxPending = 10
+	out, path := newTestProcOutput(t, maxPending)
+
+	out.Commit(1, testSegment("1234567\n")) // 8 bytes pending
+	committed := make(chan struct{})
+	go func() {
+		out.Commit(2, testSegment("abcdefg\n")) // would take the buffer to 16 bytes
+		close(committed)
+	}()
+	select {
+	case <-committed:
+		t.Fatal("out-of-order commit did not wait for room in the reorder buffer")
+	case <-time.After(50 * time.Millisecond):
+	}
+	out.mu.Lock()
+	if out.pendingBytes > maxPending {
+		t.Errorf("pending bytes %d exceed the %d byte bound", out.pendingBytes, maxPending)
+	}
+	out.mu.Unlock()
+
+	// The segment the writer waits for is never held back, however full the buffer is
+	out.Commit(0, testSegment("head of the output\n"))
+	select {
+	case <-committed:
+	case <-time.After(5 * time.Second):
+		t.Fatal("waiting commit was not released once the head segment was written")
+	}
+	if err := out.Close(3); err != nil {
+		t.Fatal(err)
+	}
+	got, _ := os.ReadFile(path)
+	if want := "head of the output\n1234567\nabcdefg\n"; string(got) != want {
+		t.Errorf("got %q, want %q", got, want)
+	}
+}
+
+func TestProcOutputCloseReportsMissingSegments(t *testing.T) {
+	out, path := newTestProcOutput(t, 1<<20)
+	out.Commit(0, testSegment("a\n"))
+	out.Commit(2, testSegment("c\n")) // seq 1 never commits, so seq 2 stays pending
+
+	err := out.Close(3)
+	if err == nil {
+		t.Fatal("Close succeeded with a missing segment")
+	}
+	if !strings.Contains(err.Error(), "wrote 1 of 3 SOL segments (1 pending)") {
+		t.Errorf("unexpected error: %v", err)
+	}
+	got, _ := os.ReadFile(path)
+	if string(got) != "a\n" {
+		t.Errorf("got %q, want only the segments before the gap", got)
+	}
+}
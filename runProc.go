@@ -3,10 +3,11 @@ package main
 import (
 	"context"
 	"database/sql"
+	"errors"
 	"fmt"
 	"log/slog"
 	"runtime"
-	"sync"
+	"sync/atomic"
 	"time"
 )
 
@@ -15,7 +16,7 @@ type ProcTask struct {
 	Proc  string
 }
 
-func runProceduresForSol(ctx context.Context, db *sql.DB, solID string, procConfig *ExtractionConfig, logCh chan<- ProcLog, mu *sync.Mutex, summary map[string]ProcSummary) {
+func runProceduresForSol(ctx context.Context, db *sql.DB, solID string, procConfig *ExtractionConfig, logCh chan<- ProcLog, summary *ProcSummaries) {
 	for _, proc := range procConfig.Procedures {
 		start := time.Now()
 		slog.Debug("Starting procedure insertion", 
@@ -38,122 +39,86 @@ func runProceduresForSol(ctx context.Context, db *sql.DB, solID string, procConf
 		} else {
 			plog.Status = "SUCCESS"
 		}
-		logCh <- plog
+		sendProcLog(logCh, plog)
+		globalMetrics.RecordPhase(proc, PhaseTask, end.Sub(start))
 
-		mu.Lock()
-		s, exists := summary[proc]
-		if !exists {
-			s = ProcSummary{Procedure: proc, StartTime: start, EndTime: end, Status: plog.Status}
-		} else {
-			if start.Before(s.StartTime) {
-				s.StartTime = start
-			}
-			if end.After(s.EndTime) {
-				s.EndTime = end
-			}
-			if s.Status != "FAIL" && plog.Status == "FAIL" {
-				s.Status = "FAIL"
-			}
-		}
-		summary[proc] = s
-		mu.Unlock()
+		summary.Record(proc, start, end, plog.Status)
 	}
 }
 
-// TaskTracker provides enhanced tracking for SOL-procedure combinations
+// taskCounts holds one procedure's task outcomes
+type taskCounts struct {
+	succeeded atomic.Int64
+	failed    atomic.Int64
+	total     int
+}
+
+// TaskTracker provides enhanced tracking for SOL-procedure combinations. Counters are
+// atomic and the procedure map is fixed at construction, so updates never lock.
 type TaskTracker struct {
-	mu                  sync.RWMutex
-	totalTasks         int
-	completedTasks     int
-	successfulTasks    int
-	failedTasks        int
-	procedureCounts    map[string]int     // completed per procedure
-	procedureFailures  map[string]int     // failures per procedure
-	procedureTotals    map[string]int     // total per procedure
-	startTime          time.Time
-	lastReportTime     time.Time
+	totalTasks      int
+	completedTasks  atomic.Int64
+	successfulTasks atomic.Int64
+	failedTasks     atomic.Int64
+	procedures      map[string]*taskCounts
+	startTime       time.Time
 }
 
 func NewTaskTracker(sols []string, procedures []string) *TaskTracker {
-	totalTasks := len(sols) * len(procedures)
-	procedureTotals := make(map[string]int)
-	procedureCounts := make(map[string]int)
-	procedureFailures := make(map[string]int)
-	
+	procs := make(map[string]*taskCounts, len(procedures))
 	for _, proc := range procedures {
-		procedureTotals[proc] = len(sols)
-		procedureCounts[proc] = 0
-		procedureFailures[proc] = 0
+		procs[proc] = &taskCounts{total: len(sols)}
 	}
-	
+
 	return &TaskTracker{
-		totalTasks:        totalTasks,
-		procedureTotals:   procedureTotals,
-		procedureCounts:   procedureCounts,
-		procedureFailures: procedureFailures,
-		startTime:         time.Now(),
-		lastReportTime:    time.Now(),
+		totalTasks: len(sols) * len(procedures),
+		procedures: procs,
+		startTime:  time.Now(),
 	}
 }
 
 func (tt *TaskTracker) UpdateTask(procedure string, success bool) {
-	tt.mu.Lock()
-	defer tt.mu.Unlock()
-	
-	tt.completedTasks++
+	counts := tt.procedures[procedure]
+	tt.completedTasks.Add(1)
 	if success {
-		tt.successfulTasks++
-		tt.procedureCounts[procedure]++
+		tt.successfulTasks.Add(1)
+		counts.succeeded.Add(1)
 	} else {
-		tt.failedTasks++
-		tt.procedureFailures[procedure]++
+		tt.failedTasks.Add(1)
+		counts.failed.Add(1)
 	}
 }
 
 func (tt *TaskTracker) GetStats() (int, int, int, int, float64, time.Duration) {
-	tt.mu.RLock()
-	defer tt.mu.RUnlock()
-	
+	completed := int(tt.completedTasks.Load())
 	elapsed := time.Since(tt.startTime)
-	rate := float64(tt.completedTasks) / elapsed.Seconds()
-	
-	return tt.completedTasks, tt.totalTasks, tt.successfulTasks, tt.failedTasks, rate, elapsed
+	rate := float64(completed) / elapsed.Seconds()
+
+	return completed, tt.totalTasks, int(tt.successfulTasks.Load()), int(tt.failedTasks.Load()), rate, elapsed
 }
 
 func (tt *TaskTracker) GetProcedureStats() map[string][3]int {
-	tt.mu.RLock()
-	defer tt.mu.RUnlock()
-	
-	stats := make(map[string][3]int) // [completed, failed, total]
-	for proc := range tt.procedureTotals {
+	stats := make(map[string][3]int, len(tt.procedures)) // [completed, failed, total]
+	for proc, counts := range tt.procedures {
 		stats[proc] = [3]int{
-			tt.procedureCounts[proc],
-			tt.procedureFailures[proc], 
-			tt.procedureTotals[proc],
+			int(counts.succeeded.Load()),
+			int(counts.failed.Load()),
+			counts.total,
 		}
 	}
 	return stats
 }
 
-func runProceduresWithProcLevelParallelism(ctx context.Context, db *sql.DB, sols []string, procConfig *ExtractionConfig, logCh chan<- ProcLog, mu *sync.Mutex, summary map[string]ProcSummary, concurrency int) {
-	// Scale task channel buffer based on workload
-	taskBufferSize := len(sols) * len(procConfig.Procedures)
-	if taskBufferSize < 1000 {
-		taskBufferSize = 1000
-	}
-	if taskBufferSize > 10000 {
-		taskBufferSize = 10000 // Cap to prevent excessive memory usage
-	}
-	taskCh := make(chan ProcTask, taskBufferSize)
-	var wg sync.WaitGroup
+// runProceduresWithProcLevelParallelism runs every (SOL, procedure) call through the shared
+// scheduler, longest expected calls first, or in adaptively sized batches per procedure
+func runProceduresWithProcLevelParallelism(ctx context.Context, db *sql.DB, sols []string, procConfig *ExtractionConfig, logCh chan<- ProcLog, summary *ProcSummaries, limiter *AIMDLimiter, maxWorkers int, history *TaskHistory) {
 	totalTasks := len(sols) * len(procConfig.Procedures)
 	overallStart := time.Now()
-	var progressMu sync.Mutex
-	completed := 0
+	var completed atomic.Int64
 	
 	// Initialize enhanced task tracker
 	tracker := NewTaskTracker(sols, procConfig.Procedures)
-	var lastDashboardTime time.Time
+	var lastProgressTime atomic.Int64 // unix nanoseconds
 
 	// Start dashboard monitoring goroutine
 	go func() {
@@ -184,15 +149,21 @@ func runProceduresWithProcLevelParallelism(ctx context.Context, db *sql.DB, sols
 					"active", dbStats.InUse,
 					"idle", dbStats.Idle,
 					"waiting", dbStats.WaitCount,
-					"max_connections", dbStats.MaxOpenConnections)
+					"max_connections", dbStats.MaxOpenConnections,
+					"concurrency_limit", limiter.Limit())
 				
 				// Show performance metrics if available
 				if globalMetrics != nil {
 					totalQueries, avgDuration, cacheHitRate, slowQueries := globalMetrics.GetStats()
 					if totalQueries > 0 {
+						queryStats := globalMetrics.QueryLatency()
 						slog.Info("Performance metrics",
 							"cache_hit_rate_percent", fmt.Sprintf("%.1f", cacheHitRate),
 							"avg_query_ms", avgDuration.Milliseconds(),
+							"p50_query_ms", fmt.Sprintf("%.1f", msec(queryStats.P50)),
+							"p95_query_ms", fmt.Sprintf("%.1f", msec(queryStats.P95)),
+							"p99_query_ms", fmt.Sprintf("%.1f", msec(queryStats.P99)),
+							"max_query_ms", fmt.Sprintf("%.1f", msec(queryStats.Max)),
 							"slow_queries", slowQueries)
 					}
 				}
@@ -216,6 +187,7 @@ func runProceduresWithProcLevelParallelism(ctx context.Context, db *sql.DB, sols
 							}
 						}
 						
+						callStats, _ := globalMetrics.PhaseStats(proc, PhaseExecute)
 						slog.Info("Procedure stats",
 							"procedure", proc,
 							"completed", completed,
@@ -223,6 +195,10 @@ func runProceduresWithProcLevelParallelism(ctx context.Context, db *sql.DB, sols
 							"progress_percent", fmt.Sprintf("%.1f", progress),
 							"successful", successCount,
 							"failed", failedCount,
+							"call_p50_ms", fmt.Sprintf("%.1f", msec(callStats.P50)),
+							"call_p95_ms", fmt.Sprintf("%.1f", msec(callStats.P95)),
+							"call_p99_ms", fmt.Sprintf("%.1f", msec(callStats.P99)),
+							"call_max_ms", fmt.Sprintf("%.1f", msec(callStats.Max)),
 							"status", status)
 					}
 				}
@@ -231,131 +207,197 @@ func runProceduresWithProcLevelParallelism(ctx context.Context, db *sql.DB, sols
 		}
 	}()
 
-	for range concurrency {
-		wg.Add(1)
-		go func() {
-			defer wg.Done()
-			for task := range taskCh {
-				start := time.Now()
-				
-				// Enhanced task logging with queue info
-				queueRemaining := len(taskCh)
-				completedSoFar, _, _, _, _, _ := tracker.GetStats()
-				taskNumber := completedSoFar + 1
-				
-				if runtime.GOMAXPROCS(0) <= 4 {
-					slog.Debug("Starting task", 
-						"task_num", taskNumber, 
-						"total_tasks", totalTasks, 
-						"package", procConfig.PackageName, 
-						"procedure", task.Proc, 
-						"sol_id", task.SolID, 
-						"queue_remaining", queueRemaining)
-				}
-				
-				err := callProcedure(ctx, db, procConfig.PackageName, task.Proc, task.SolID)
-				end := time.Now()
-				duration := end.Sub(start)
+	// finishTask records one (SOL, procedure) outcome in the log, tracker, summary and progress
+	finishTask := func(task ProcTask, taskNumber int, start, end time.Time, err error) {
+		duration := end.Sub(start)
 
-				plog := ProcLog{
-					SolID:         task.SolID,
-					Procedure:     task.Proc,
-					StartTime:     start,
-					EndTime:       end,
-					ExecutionTime: duration,
-				}
-				
-				success := err == nil
-				if err != nil {
-					plog.Status = "FAIL"
-					plog.ErrorDetails = err.Error()
-					if runtime.GOMAXPROCS(0) <= 4 {
-						slog.Error("Task failed", 
-							"task_num", taskNumber, 
-							"total_tasks", totalTasks, 
-							"package", procConfig.PackageName, 
-							"procedure", task.Proc, 
-							"sol_id", task.SolID, 
-							"duration", duration.Round(time.Millisecond).String(), 
-							"error", err.Error())
-					}
-				} else {
-					plog.Status = "SUCCESS"
-					if runtime.GOMAXPROCS(0) <= 4 {
-						slog.Debug("Task completed successfully", 
-							"task_num", taskNumber, 
-							"total_tasks", totalTasks, 
-							"package", procConfig.PackageName, 
-							"procedure", task.Proc, 
-							"sol_id", task.SolID, 
-							"duration", duration.Round(time.Millisecond).String())
-					}
-				}
-				logCh <- plog
+		plog := ProcLog{
+			SolID:         task.SolID,
+			Procedure:     task.Proc,
+			StartTime:     start,
+			EndTime:       end,
+			ExecutionTime: duration,
+		}
+		
+		success := err == nil
+		if err != nil {
+			plog.Status = "FAIL"
+			if errors.Is(err, errPartialCommit) {
+				plog.Status = statusFailPartialCommit
+			}
+			plog.ErrorDetails = err.Error()
+			if runtime.GOMAXPROCS(0) <= 4 {
+				slog.Error("Task failed", 
+					"task_num", taskNumber, 
+					"total_tasks", totalTasks, 
+					"package", procConfig.PackageName, 
+					"procedure", task.Proc, 
+					"sol_id", task.SolID, 
+					"duration", duration.Round(time.Millisecond).String(), 
+					"error", err.Error())
+			}
+		} else {
+			plog.Status = "SUCCESS"
+			if runtime.GOMAXPROCS(0) <= 4 {
+				slog.Debug("Task completed successfully", 
+					"task_num", taskNumber, 
+					"total_tasks", totalTasks, 
+					"package", procConfig.PackageName, 
+					"procedure", task.Proc, 
+					"sol_id", task.SolID, 
+					"duration", duration.Round(time.Millisecond).String())
+			}
+		}
+		sendProcLog(logCh, plog)
 
-				// Update enhanced tracker
-				tracker.UpdateTask(task.Proc, success)
+		// Update enhanced tracker
+		tracker.UpdateTask(task.Proc, success)
 
-				// Batch summary updates to reduce mutex contention
-				mu.Lock()
-				s, exists := summary[task.Proc]
-				if !exists {
-					s = ProcSummary{Procedure: task.Proc, StartTime: start, EndTime: end, Status: plog.Status}
-				} else {
-					if start.Before(s.StartTime) {
-						s.StartTime = start
-					}
-					if end.After(s.EndTime) {
-						s.EndTime = end
-					}
-					if s.Status != "FAIL" && plog.Status == "FAIL" {
-						s.Status = "FAIL"
-					}
-				}
-				summary[task.Proc] = s
-				mu.Unlock()
+		summary.Record(task.Proc, start, end, plog.Status)
 
-				// Enhanced progress reporting
-				progressMu.Lock()
-				completed++
-				localCompleted := completed
-				progressMu.Unlock()
-				
-				// More frequent progress updates with enhanced info
-				if localCompleted%10 == 0 || localCompleted == totalTasks || time.Since(lastDashboardTime) > 15*time.Second {
-					elapsed := time.Since(overallStart)
-					rate := float64(localCompleted) / elapsed.Seconds()
-					eta := time.Duration(float64(totalTasks-localCompleted) / rate) * time.Second
-					
-					successCount, failCount := 0, 0
-					procStats := tracker.GetProcedureStats()
-					for _, stats := range procStats {
-						successCount += stats[0]
-						failCount += stats[1]
+		// Enhanced progress reporting
+		localCompleted := int(completed.Add(1))
+		
+		// More frequent progress updates with enhanced info
+		if localCompleted%10 == 0 || localCompleted == totalTasks || time.Since(time.Unix(0, lastProgressTime.Load())) > 15*time.Second {
+			elapsed := time.Since(overallStart)
+			rate := float64(localCompleted) / elapsed.Seconds()
+			eta := time.Duration(float64(totalTasks-localCompleted) / rate) * time.Second
+			
+			_, _, successCount, failCount, _, _ := tracker.GetStats()
+			
+			slog.Info("Task progress", 
+				"completed", localCompleted, 
+				"total", totalTasks, 
+				"progress_percent", fmt.Sprintf("%.1f", float64(localCompleted)*100/float64(totalTasks)),
+				"rate_per_second", fmt.Sprintf("%.1f", rate), 
+				"successful", successCount, 
+				"failed", failCount,
+				"eta", eta.Round(time.Second).String())
+			
+			lastProgressTime.Store(time.Now().UnixNano())
+		}
+	}
+
+	// Batched mode sends groups of SOLs per procedure call, sized per procedure by call latency
+	batchMode := procConfig.InsertBatchSize > 1
+	sizers := make(map[string]*BatchSizer)
+	if batchMode {
+		for _, proc := range procConfig.Procedures {
+			sizers[proc] = NewBatchSizer(procConfig.InsertBatchSize, procConfig.InsertBatchMaxSize,
+				time.Duration(procConfig.InsertBatchTargetMs)*time.Millisecond)
+		}
+		slog.Info("Batched procedure calls enabled",
+			"initial_batch_size", procConfig.InsertBatchSize,
+			"max_batch_size", procConfig.InsertBatchMaxSize,
+			"target_call_ms", procConfig.InsertBatchTargetMs,
+			"error_buffer_mb_per_call", fmt.Sprintf("%.1f", float64(procConfig.InsertBatchMaxSize*batchErrorBufferSize)/(1024*1024)))
+	}
+
+	var taskCh <-chan SchedTask
+	if batchMode {
+		// Each procedure walks the SOL list at its own pace, taking its current batch size.
+		// The queue stays short so new batches pick up size changes quickly.
+		batchCh := make(chan SchedTask, limiter.Limit())
+		go func() {
+			defer close(batchCh)
+			offsets := make([]int, len(procConfig.Procedures))
+			for remaining := true; remaining; {
+				remaining = false
+				for i, proc := range procConfig.Procedures {
+					if offsets[i] >= len(sols) {
+						continue
 					}
-					
-					slog.Info("Task progress", 
-						"completed", localCompleted, 
-						"total", totalTasks, 
-						"progress_percent", fmt.Sprintf("%.1f", float64(localCompleted)*100/float64(totalTasks)),
-						"rate_per_second", fmt.Sprintf("%.1f", rate), 
-						"successful", successCount, 
-						"failed", failCount,
-						"eta", eta.Round(time.Second).String())
-					
-					lastDashboardTime = time.Now()
+					end := min(offsets[i]+sizers[proc].Size(), len(sols))
+					batchCh <- SchedTask{Proc: proc, SolIDs: sols[offsets[i]:end], Seq: offsets[i]}
+					offsets[i] = end
+					remaining = remaining || end < len(sols)
 				}
 			}
 		}()
+		taskCh = batchCh
+	} else {
+		tasks := make([]SchedTask, 0, totalTasks)
+		for i := range sols {
+			for _, proc := range procConfig.Procedures {
+				solIDs := sols[i : i+1]
+				tasks = append(tasks, SchedTask{Proc: proc, SolIDs: solIDs, Seq: i, Weight: history.Weight(proc, solIDs)})
+			}
+		}
+		sortLongestFirst(tasks)
+		taskCh = feedTasks(tasks)
 	}
 
-	for _, sol := range sols {
-		for _, proc := range procConfig.Procedures {
-			taskCh <- ProcTask{SolID: sol, Proc: proc}
+	runScheduled(limiter, maxWorkers, taskCh, func(task SchedTask) {
+		if batchMode {
+			start := time.Now()
+			results, err := callProcedureBatch(ctx, db, procConfig.PackageName, task.Proc, task.SolIDs)
+			end := time.Now()
+			sizers[task.Proc].Observe(len(task.SolIDs), end.Sub(start))
+
+			if err != nil && !errors.Is(err, errBatchNotRun) {
+				// The block may have run, and a procedure that commits internally keeps its
+				// work despite the rollback, so retrying could call a SOL twice. Fail them all.
+				slog.Error("Batched procedure call failed, marking its SOLs failed",
+					"package", procConfig.PackageName,
+					"procedure", task.Proc,
+					"sol_count", len(task.SolIDs),
+					"first_sol_id", task.SolIDs[0],
+					"error", err)
+				for i, solID := range task.SolIDs {
+					solStart, solEnd := batchShare(start, end, i, len(task.SolIDs))
+					completedSoFar, _, _, _, _, _ := tracker.GetStats()
+					finishTask(ProcTask{SolID: solID, Proc: task.Proc}, completedSoFar+1, solStart, solEnd, err)
+				}
+				return
+			}
+			if err != nil {
+				// Nothing ran, so the SOLs can be retried as single calls
+				slog.Warn("Batched procedure call did not run, retrying one SOL at a time",
+					"package", procConfig.PackageName,
+					"procedure", task.Proc,
+					"sol_count", len(task.SolIDs),
+					"first_sol_id", task.SolIDs[0],
+					"error", err)
+				for _, solID := range task.SolIDs {
+					solStart := time.Now()
+					err := callProcedure(ctx, db, procConfig.PackageName, task.Proc, solID)
+					completedSoFar, _, _, _, _, _ := tracker.GetStats()
+					finishTask(ProcTask{SolID: solID, Proc: task.Proc}, completedSoFar+1, solStart, time.Now(), err)
+				}
+				return
+			}
+
+			for i, solID := range task.SolIDs {
+				solStart, solEnd := batchShare(start, end, i, len(task.SolIDs))
+				completedSoFar, _, _, _, _, _ := tracker.GetStats()
+				finishTask(ProcTask{SolID: solID, Proc: task.Proc}, completedSoFar+1, solStart, solEnd, results[i])
+			}
+			return
 		}
-	}
-	close(taskCh)
-	wg.Wait()
+
+		start := time.Now()
+		solID := task.SolIDs[0]
+
+		// Enhanced task logging with queue info
+		queueRemaining := len(taskCh)
+		completedSoFar, _, _, _, _, _ := tracker.GetStats()
+		taskNumber := completedSoFar + 1
+
+		if runtime.GOMAXPROCS(0) <= 4 {
+			slog.Debug("Starting task",
+				"task_num", taskNumber,
+				"total_tasks", totalTasks,
+				"package", procConfig.PackageName,
+				"procedure", task.Proc,
+				"sol_id", solID,
+				"queue_remaining", queueRemaining)
+		}
+
+		err := callProcedure(ctx, db, procConfig.PackageName, task.Proc, solID)
+		end := time.Now()
+		finishTask(ProcTask{SolID: solID, Proc: task.Proc}, taskNumber, start, end, err)
+	})
 }
 
 // Prepared statement cache for procedure calls
@@ -370,8 +412,11 @@ func callProcedure(ctx context.Context, db *sql.DB, pkgName, procName, solID str
 	if err != nil {
 		return fmt.Errorf("failed to prepare procedure statement: %w", err)
 	}
+	execStart := time.Now()
+	globalMetrics.RecordPhase(procName, PhasePrepare, execStart.Sub(start))
 	
 	_, err = stmt.ExecContext(ctx, solID)
+	globalMetrics.RecordPhase(procName, PhaseExecute, time.Since(execStart))
 	
 	// Reduce verbose logging for performance - only log slow procedures
 	duration := time.Since(start)
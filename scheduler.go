@@ -0,0 +1,352 @@
+package main
+
+import (
+	"cmp"
+	"context"
+	"database/sql"
+	"encoding/csv"
+	"errors"
+	"io"
+	"log/slog"
+	"math"
+	"os"
+	"slices"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// SchedTask is one unit of scheduled work: a procedure over one SOL or a batch of SOLs
+type SchedTask struct {
+	Proc   string
+	SolIDs []string
+	Seq    int           // run position of SolIDs[0], orders direct output segments
+	Weight time.Duration // expected duration from the previous run, for longest-first dispatch
+}
+
+// AIMD tuning for the concurrency limiter
+const (
+	aimdInterval         = time.Second
+	aimdDecreaseFactor   = 0.75
+	aimdLatencyTolerance = 1.5                   // window latency over the per-procedure baseline that counts as congestion
+	aimdWaitTolerance    = 0.1                   // share of the interval spent waiting for pool connections that counts as congestion
+	aimdBaselineWeight   = 0.05                  // EWMA weight of each sample in the latency baseline
+	aimdMinSamples       = 5                     // latency samples needed before a window is judged
+	aimdMaxAvgPoolWait   = 10 * time.Millisecond // average wait per pool wait that counts as congestion
+)
+
+// AIMDLimiter bounds the number of tasks in flight. Every interval it grows the limit by
+// one if the limit was reached and the database looked healthy, and cuts it by a quarter
+// if tasks waited for pool connections or ran slower than their procedure's baseline.
+// Starting and finishing a task are atomic operations; only waiting for a slot and the
+// periodic adjustment touch the wake channel and the mutex.
+type AIMDLimiter struct {
+	limit    atomic.Int64
+	inFlight atomic.Int64
+	waiters  atomic.Int64
+	reached  atomic.Bool   // in-flight hit the limit during this window
+	wake     chan struct{} // holds at most one token for a waiter to recheck the slots
+	minLimit int
+	maxLimit int
+
+	baselines     sync.Map       // procedure -> *atomic.Uint64, EWMA task latency in seconds as float64 bits
+	windowRatio   ShardedCounter // sum of latency/baseline ratios, in millionths
+	windowSamples ShardedCounter
+
+	mu               sync.Mutex // serializes adjust and guards the fields below
+	stats            func() sql.DBStats
+	lastWaitDuration time.Duration
+	lastWaitCount    int64
+	lastRatio        int64
+	lastSamples      int64
+}
+
+func NewAIMDLimiter(initial, minLimit, maxLimit int, stats func() sql.DBStats) *AIMDLimiter {
+	minLimit = max(minLimit, 1)
+	maxLimit = max(maxLimit, minLimit)
+	l := &AIMDLimiter{
+		wake:     make(chan struct{}, 1),
+		minLimit: minLimit,
+		maxLimit: maxLimit,
+		stats:    stats,
+	}
+	l.limit.Store(int64(min(max(initial, minLimit), maxLimit)))
+	if stats != nil {
+		s := stats()
+		l.lastWaitDuration, l.lastWaitCount = s.WaitDuration, s.WaitCount
+	}
+	return l
+}
+
+// Acquire blocks until a task may start
+func (l *AIMDLimiter) Acquire() {
+	if l.tryAcquire() {
+		return
+	}
+	// Register before rechecking, so a slot freed after the recheck sees the waiter and
+	// leaves a token
+	l.waiters.Add(1)
+	for !l.tryAcquire() {
+		<-l.wake
+	}
+	l.waiters.Add(-1)
+}
+
+// tryAcquire takes a slot if one is free
+func (l *AIMDLimiter) tryAcquire() bool {
+	for {
+		n, limit := l.inFlight.Load(), l.limit.Load()
+		if n >= limit {
+			return false
+		}
+		if l.inFlight.CompareAndSwap(n, n+1) {
+			if n+1 >= limit {
+				l.reached.Store(true)
+			} else {
+				// Slots remain, e.g. after the limit grew; pass the wake-up on
+				l.signal()
+			}
+			return true
+		}
+	}
+}
+
+// signal wakes one waiter, if any, to recheck the slots
+func (l *AIMDLimiter) signal() {
+	if l.waiters.Load() == 0 {
+		return
+	}
+	select {
+	case l.wake <- struct{}{}:
+	default:
+	}
+}
+
+// Release ends a task and feeds its per-SOL latency into the current window
+func (l *AIMDLimiter) Release(proc string, latency time.Duration) {
+	seconds := latency.Seconds()
+	if v, ok := l.baselines.Load(proc); ok {
+		baseline := v.(*atomic.Uint64)
+		for {
+			old := baseline.Load()
+			current := math.Float64frombits(old)
+			if current <= 0 {
+				if baseline.CompareAndSwap(old, math.Float64bits(seconds)) {
+					break
+				}
+				continue
+			}
+			next := current + aimdBaselineWeight*(seconds-current)
+			if baseline.CompareAndSwap(old, math.Float64bits(next)) {
+				l.windowRatio.Add(int64(seconds / current * 1e6))
+				l.windowSamples.Add(1)
+				break
+			}
+		}
+	} else {
+		baseline := new(atomic.Uint64)
+		baseline.Store(math.Float64bits(seconds))
+		l.baselines.LoadOrStore(proc, baseline)
+	}
+	l.inFlight.Add(-1)
+	l.signal()
+}
+
+// Cancel gives back a slot that was acquired but not used
+func (l *AIMDLimiter) Cancel() {
+	l.inFlight.Add(-1)
+	l.signal()
+}
+
+// Limit returns the current concurrency limit
+func (l *AIMDLimiter) Limit() int {
+	return int(l.limit.Load())
+}
+
+// Run adjusts the limit every interval until the context is done
+func (l *AIMDLimiter) Run(ctx context.Context) {
+	ticker := time.NewTicker(aimdInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ticker.C:
+			l.adjust(aimdInterval)
+		case <-ctx.Done():
+			return
+		}
+	}
+}
+
+func (l *AIMDLimiter) adjust(interval time.Duration) {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+
+	var waitDelta time.Duration
+	var waitCount int64
+	if l.stats != nil {
+		s := l.stats()
+		waitDelta, waitCount = s.WaitDuration-l.lastWaitDuration, s.WaitCount-l.lastWaitCount
+		l.lastWaitDuration, l.lastWaitCount = s.WaitDuration, s.WaitCount
+	}
+	// The window is what the counters gained since the last adjustment
+	ratio, samples := l.windowRatio.Load(), l.windowSamples.Load()
+	windowRatio, windowSamples := float64(ratio-l.lastRatio)/1e6, samples-l.lastSamples
+	l.lastRatio, l.lastSamples = ratio, samples
+
+	poolCongested := waitDelta > time.Duration(float64(interval)*aimdWaitTolerance) ||
+		(waitCount > 0 && waitDelta/time.Duration(waitCount) > aimdMaxAvgPoolWait)
+	latencyCongested := windowSamples >= aimdMinSamples &&
+		windowRatio/float64(windowSamples) > aimdLatencyTolerance
+
+	previous := int(l.limit.Load())
+	limit := previous
+	switch {
+	case poolCongested || latencyCongested:
+		limit = max(int(float64(previous)*aimdDecreaseFactor), l.minLimit)
+	case l.reached.Load():
+		limit = min(previous+1, l.maxLimit)
+	}
+	if limit != previous {
+		l.limit.Store(int64(limit))
+		if limit > previous {
+			l.signal()
+		}
+		slog.Debug("Concurrency limit adjusted",
+			"previous", previous,
+			"limit", limit,
+			"pool_wait", waitDelta.String(),
+			"pool_congested", poolCongested,
+			"latency_congested", latencyCongested)
+	}
+
+	l.reached.Store(l.inFlight.Load() >= int64(limit))
+}
+
+// runScheduled runs tasks from the channel on up to maxWorkers goroutines, admitting each
+// through the limiter, and returns once the channel is closed and drained. A slot is
+// taken before a task is received, so tasks start in channel order.
+func runScheduled(limiter *AIMDLimiter, maxWorkers int, tasks <-chan SchedTask, run func(SchedTask)) {
+	var wg sync.WaitGroup
+	for range max(maxWorkers, 1) {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for {
+				limiter.Acquire()
+				task, ok := <-tasks
+				if !ok {
+					limiter.Cancel()
+					return
+				}
+				start := time.Now()
+				run(task)
+				elapsed := time.Since(start)
+				globalMetrics.RecordPhase(task.Proc, PhaseTask, elapsed)
+				limiter.Release(task.Proc, elapsed/time.Duration(max(len(task.SolIDs), 1)))
+			}
+		}()
+	}
+	wg.Wait()
+}
+
+// feedTasks sends tasks to a new channel from a background goroutine and closes it when done
+func feedTasks(tasks []SchedTask) <-chan SchedTask {
+	taskCh := make(chan SchedTask, 1024)
+	go func() {
+		defer close(taskCh)
+		for _, task := range tasks {
+			taskCh <- task
+		}
+	}()
+	return taskCh
+}
+
+// sortLongestFirst orders tasks by descending expected duration so the slowest work
+// starts early and does not leave the tail of the run idle. Ties keep their order.
+func sortLongestFirst(tasks []SchedTask) {
+	slices.SortStableFunc(tasks, func(a, b SchedTask) int {
+		return cmp.Compare(b.Weight, a.Weight)
+	})
+}
+
+type taskKey struct {
+	solID string
+	proc  string
+}
+
+// TaskHistory holds (SOL, procedure) durations from the previous run's procedure log
+type TaskHistory struct {
+	durations map[taskKey]time.Duration
+	procMeans map[string]time.Duration
+}
+
+// loadTaskHistory reads a previous run's _extract.csv or _insert.csv. It must be called
+// before writeLog truncates the file; a missing or unreadable log gives an empty history.
+func loadTaskHistory(path string) *TaskHistory {
+	h := &TaskHistory{
+		durations: make(map[taskKey]time.Duration),
+		procMeans: make(map[string]time.Duration),
+	}
+	f, err := os.Open(path)
+	if err != nil {
+		if !errors.Is(err, os.ErrNotExist) {
+			slog.Warn("Failed to open previous run log", "path", path, "error", err)
+		}
+		return h
+	}
+	defer f.Close()
+
+	r := csv.NewReader(f)
+	r.ReuseRecord = true
+	r.FieldsPerRecord = -1
+	if _, err := r.Read(); err != nil {
+		return h
+	}
+
+	for {
+		record, err := r.Read()
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			slog.Warn("Stopped reading previous run log", "path", path, "error", err)
+			break
+		}
+		if len(record) < 5 {
+			continue
+		}
+		seconds, err := strconv.ParseFloat(record[4], 64)
+		if err != nil {
+			continue
+		}
+		d := time.Duration(seconds * float64(time.Second))
+		// Chunked procedures log one line per chunk, so durations add up
+		h.durations[taskKey{solID: record[0], proc: record[1]}] += d
+	}
+	// Means are per task, not per log line, so a chunked procedure's mean is a whole SOL
+	procTotals := make(map[string]time.Duration)
+	procCounts := make(map[string]int)
+	for key, d := range h.durations {
+		procTotals[key.proc] += d
+		procCounts[key.proc]++
+	}
+	for proc, total := range procTotals {
+		h.procMeans[proc] = total / time.Duration(procCounts[proc])
+	}
+	slog.Info("Loaded previous run durations", "path", path, "tasks", len(h.durations), "procedures", len(h.procMeans))
+	return h
+}
+
+// Weight estimates a task's duration, falling back to the procedure's mean for unseen SOLs
+func (h *TaskHistory) Weight(proc string, solIDs []string) time.Duration {
+	var total time.Duration
+	for _, solID := range solIDs {
+		if d, ok := h.durations[taskKey{solID: solID, proc: proc}]; ok {
+			total += d
+		} else {
+			total += h.procMeans[proc]
+		}
+	}
+	return total
+}
@@ -0,0 +1,122 @@
+package main
+
+import (
+	"os"
+	"path/filepath"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+)
+
+func TestAIMDLimiterBoundsInFlight(t *testing.T) {
+	const limit = 4
+	l := NewAIMDLimiter(limit, 1, limit, nil)
+	var running, peak atomic.Int64
+	var wg sync.WaitGroup
+	for range 32 {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for range 200 {
+				l.Acquire()
+				n := running.Add(1)
+				for {
+					p := peak.Load()
+					if n <= p || peak.CompareAndSwap(p, n) {
+						break
+					}
+				}
+				running.Add(-1)
+				l.Release("P", time.Millisecond)
+			}
+		}()
+	}
+	wg.Wait()
+	if peak.Load() > limit {
+		t.Errorf("%d tasks in flight, limit %d", peak.Load(), limit)
+	}
+	if n := l.inFlight.Load(); n != 0 {
+		t.Errorf("%d slots still held after every task released", n)
+	}
+}
+
+func TestAIMDLimiterGrowthWakesWaiters(t *testing.T) {
+	l := NewAIMDLimiter(1, 1, 4, nil)
+	l.Acquire()
+
+	acquired := make(chan struct{}, 3)
+	for range 3 {
+		go func() {
+			l.Acquire()
+			acquired <- struct{}{}
+		}()
+	}
+	select {
+	case <-acquired:
+		t.Fatal("a waiter started past the limit")
+	case <-time.After(20 * time.Millisecond):
+	}
+
+	// Each adjustment of a saturated limiter adds one slot, which one waiter must take
+	for i := range 3 {
+		l.adjust(time.Second)
+		if got := l.Limit(); got != i+2 {
+			t.Fatalf("limit %d after %d adjustments, want %d", got, i+1, i+2)
+		}
+		select {
+		case <-acquired:
+		case <-time.After(5 * time.Second):
+			t.Fatalf("no waiter woke after the limit grew to %d", l.Limit())
+		}
+	}
+}
+
+func TestAIMDLimiterBacksOffOnLatency(t *testing.T) {
+	l := NewAIMDLimiter(8, 1, 8, nil)
+	for range aimdMinSamples + 1 {
+		l.Acquire()
+		l.Release("P", 10*time.Millisecond)
+	}
+	l.adjust(time.Second) // the window that set the baseline is healthy
+	if got := l.Limit(); got != 8 {
+		t.Fatalf("limit %d after a healthy window, want 8", got)
+	}
+
+	for range aimdMinSamples {
+		l.Acquire()
+		l.Release("P", 50*time.Millisecond)
+	}
+	l.adjust(time.Second)
+	if got := l.Limit(); got != 6 {
+		t.Errorf("limit %d after a slow window, want 6", got)
+	}
+}
+
+func TestTaskHistoryMeansArePerTask(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "run_extract.csv")
+	log := `SOL_ID,PROCEDURE,START_TIME,END_TIME,EXECUTION_SECONDS,STATUS,ERROR_DETAILS
+SOL-1,P_CHUNK,,,1.000,SUCCESS,-
+SOL-1,P_CHUNK,,,1.000,SUCCESS,-
+SOL-1,P_CHUNK,,,2.000,SUCCESS,-
+SOL-2,P_CHUNK,,,2.000,SUCCESS,-
+SOL-1,P_PLAIN,,,0.500,SUCCESS,-
+SOL-2,P_PLAIN,,,1.500,FAIL,ORA-01013
+`
+	if err := os.WriteFile(path, []byte(log), 0o644); err != nil {
+		t.Fatal(err)
+	}
+	h := loadTaskHistory(path)
+
+	// A chunked SOL logs one line per chunk; its task is the sum of its chunks
+	if got := h.Weight("P_CHUNK", []string{"SOL-1"}); got != 4*time.Second {
+		t.Errorf("SOL-1 weight %v, want its chunks' 4s", got)
+	}
+	// and the mean for unseen SOLs averages tasks, (4s + 2s) / 2, not the four lines
+	if got := h.Weight("P_CHUNK", []string{"SOL-9"}); got != 3*time.Second {
+		t.Errorf("unseen SOL weight %v, want the 3s mean per task", got)
+	}
+	if got := h.Weight("P_PLAIN", []string{"SOL-1", "SOL-9"}); got != 1500*time.Millisecond {
+		t.Errorf("batch weight %v, want 0.5s plus the 1s mean", got)
+	}
+}
@@ -0,0 +1,554 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"database/sql/driver"
+	"errors"
+	"fmt"
+	"io"
+	"math"
+	"math/rand"
+	"regexp"
+	"slices"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/godror/godror"
+)
+
+// The synthetic database is a database/sql driver that stands in for godror in the
+// package's tests and benchmarks. It answers every statement shape this tool issues with
+// generated rows, so runs can be measured without an Oracle instance:
+//
+//	SELECT <cols> FROM <proc> WHERE SOL_ID = :1                       one SOL's rows
+//	SELECT SOL_ID, <cols> FROM <proc> WHERE SOL_ID IN (...) ORDER BY  a batch's rows
+//	BEGIN <pkg>.<proc>(:1); END;                                       a procedure call
+//	BEGIN SAVEPOINT ... <pkg>.<proc>(:1); ... END;                     a batched call
+//	BEGIN <pkg>.<proc>_EXTRACT(:1, :2, :3, :4); END;                   a refcursor chunk
+//
+// Rows per SOL and failures are derived from a hash of the SOL and procedure, so every
+// run and every extraction path sees the same data. Cell values are boxed once per
+// procedure and reused, so allocations measured against it are the extractor's own.
+
+const syntheticDriverName = "synthetic"
+
+// syntheticValueRows is the number of distinct generated rows each procedure cycles through
+const syntheticValueRows = 64
+
+// SyntheticProcedure shapes what the synthetic database returns for one procedure
+type SyntheticProcedure struct {
+	RowsMin      int     `json:"rows_min"`       // rows per SOL, picked per SOL between min and max
+	RowsMax      int     `json:"rows_max"`       // Default: rows_min
+	Columns      int     `json:"columns"`        // Default: 20, cycling VARCHAR, NUMBER and DATE
+	ColumnWidth  int     `json:"column_width"`   // Default: 16 characters per VARCHAR value
+	RoundTripMs  float64 `json:"round_trip_ms"`  // fixed network time per execute
+	LatencyP50Ms float64 `json:"latency_p50_ms"` // log-normal server time per SOL
+	LatencyP99Ms float64 `json:"latency_p99_ms"` // Default: latency_p50_ms, i.e. constant
+	FailureRate  float64 `json:"failure_rate"`   // share of (SOL, procedure) pairs that fail, 0-1
+	CommitRate   float64 `json:"commit_rate"`    // share of failing pairs that committed first, reported by batched calls as such
+	BatchFailure string  `json:"batch_failure"`  // "prepare" or "execute": every batched call fails at that step
+	SolIDWidth   int     `json:"sol_id_width"`   // blank-pad the returned SOL_ID to this width, as a CHAR column does
+}
+
+// SyntheticDB is the synthetic database's configuration. Procedures without a profile use Default.
+type SyntheticDB struct {
+	Procedures map[string]SyntheticProcedure `json:"procedures"`
+	Default    SyntheticProcedure            `json:"default"`
+}
+
+// syntheticProc is a compiled profile with its reusable cell values
+type syntheticProc struct {
+	name    string
+	profile SyntheticProcedure
+	columns []string
+	values  [][]driver.Value // syntheticValueRows rows of all columns
+	sigma   float64          // log-normal shape of the server time
+}
+
+type syntheticState struct {
+	procs     map[string]*syntheticProc
+	fallback  SyntheticProcedure
+	fallbacks sync.Map // procedure name -> *syntheticProc compiled from fallback
+}
+
+var syntheticCurrent atomic.Pointer[syntheticState]
+
+func init() {
+	sql.Register(syntheticDriverName, syntheticDriver{})
+	setSyntheticDB(SyntheticDB{})
+}
+
+// setSyntheticDB replaces the synthetic database's configuration for new statements
+func setSyntheticDB(cfg SyntheticDB) {
+	state := &syntheticState{
+		procs:    make(map[string]*syntheticProc, len(cfg.Procedures)),
+		fallback: cfg.Default,
+	}
+	for name, profile := range cfg.Procedures {
+		state.procs[strings.ToUpper(name)] = compileSyntheticProc(name, profile)
+	}
+	syntheticCurrent.Store(state)
+}
+
+func (s *syntheticState) procedure(name string) *syntheticProc {
+	key := strings.ToUpper(name)
+	if p, ok := s.procs[key]; ok {
+		return p
+	}
+	if p, ok := s.fallbacks.Load(key); ok {
+		return p.(*syntheticProc)
+	}
+	p, _ := s.fallbacks.LoadOrStore(key, compileSyntheticProc(name, s.fallback))
+	return p.(*syntheticProc)
+}
+
+// withSyntheticDefaults fills in a profile's unset fields
+func withSyntheticDefaults(p SyntheticProcedure) SyntheticProcedure {
+	p.RowsMin = max(p.RowsMin, 0)
+	p.RowsMax = max(p.RowsMax, p.RowsMin)
+	if p.Columns <= 0 {
+		p.Columns = 20
+	}
+	if p.ColumnWidth <= 0 {
+		p.ColumnWidth = 16
+	}
+	p.LatencyP99Ms = max(p.LatencyP99Ms, p.LatencyP50Ms)
+	return p
+}
+
+// syntheticColumns returns the template columns matching a profile's generated values
+func syntheticColumns(p SyntheticProcedure) []ColumnConfig {
+	p = withSyntheticDefaults(p)
+	cols := make([]ColumnConfig, p.Columns)
+	for i := range cols {
+		cols[i] = ColumnConfig{Name: "COL_" + strconv.Itoa(i+1), Length: p.ColumnWidth, Align: "left"}
+		switch i % 3 {
+		case 1: // NUMBER
+			cols[i].Length, cols[i].Align = 14, "right"
+		case 2: // DATE, RFC 3339 in UTC
+			cols[i].Length = 20
+		}
+	}
+	return cols
+}
+
+func compileSyntheticProc(name string, profile SyntheticProcedure) *syntheticProc {
+	profile = withSyntheticDefaults(profile)
+	p := &syntheticProc{name: name, profile: profile}
+	for _, col := range syntheticColumns(profile) {
+		p.columns = append(p.columns, col.Name)
+	}
+	if profile.LatencyP50Ms > 0 {
+		// p99 is 2.326 standard deviations above the median of the underlying normal
+		p.sigma = math.Log(profile.LatencyP99Ms/profile.LatencyP50Ms) / 2.326
+	}
+
+	base := time.Date(2025, 1, 1, 0, 0, 0, 0, time.UTC)
+	p.values = make([][]driver.Value, syntheticValueRows)
+	for r := range p.values {
+		row := make([]driver.Value, profile.Columns)
+		for c := range row {
+			switch {
+			case c%3 == 1:
+				row[c] = godror.Number(strconv.FormatFloat(float64(r*1000+c)+0.25, 'f', -1, 64))
+			case c%3 == 2:
+				row[c] = base.AddDate(0, 0, r+c)
+			case (r+c)%11 == 0:
+				row[c] = nil
+			default:
+				row[c] = strings.Repeat(string(rune('A'+(r+c)%26)), max(profile.ColumnWidth-r%4, 1))
+			}
+		}
+		p.values[r] = row
+	}
+	return p
+}
+
+// solHash hashes the procedure and SOL with FNV-1a and a murmur3 finalizer, so outcomes
+// are stable across runs and well spread even for sequential SOL IDs
+func (p *syntheticProc) solHash(solID string) uint64 {
+	h := uint64(14695981039346656037)
+	for _, s := range [2]string{p.name, solID} {
+		for i := 0; i < len(s); i++ {
+			h ^= uint64(s[i])
+			h *= 1099511628211
+		}
+		h ^= '/'
+		h *= 1099511628211
+	}
+	h ^= h >> 33
+	h *= 0xff51afd7ed558ccd
+	h ^= h >> 33
+	h *= 0xc4ceb9fe1a85ec53
+	h ^= h >> 33
+	return h
+}
+
+// rowCount returns the number of rows the procedure holds for a SOL
+func (p *syntheticProc) rowCount(solID string) int {
+	span := p.profile.RowsMax - p.profile.RowsMin + 1
+	return p.profile.RowsMin + int(p.solHash(solID)>>1%uint64(span))
+}
+
+// failure returns the error the procedure raises for a SOL, if it is one that fails
+func (p *syntheticProc) failure(solID string) error {
+	if p.profile.FailureRate <= 0 {
+		return nil
+	}
+	if float64(p.solHash(solID)>>11)/(1<<53) >= p.profile.FailureRate {
+		return nil
+	}
+	return fmt.Errorf("ORA-20001: synthetic failure in %s for SOL %s", p.name, solID)
+}
+
+// committed reports whether a failing SOL's procedure committed part of its work first
+func (p *syntheticProc) committed(solID string) bool {
+	return float64(p.solHash(solID)&(1<<11-1))/(1<<11) < p.profile.CommitRate
+}
+
+// serverTime draws the time the database spends on sols SOLs
+func (p *syntheticProc) serverTime(sols int) time.Duration {
+	if p.profile.LatencyP50Ms <= 0 {
+		return 0
+	}
+	var ms float64
+	for range sols {
+		ms += p.profile.LatencyP50Ms * math.Exp(p.sigma*rand.NormFloat64())
+	}
+	return time.Duration(ms * float64(time.Millisecond))
+}
+
+// wait sleeps for one round trip plus the server time of sols SOLs, or until ctx is done
+func (p *syntheticProc) wait(ctx context.Context, sols int) error {
+	d := time.Duration(p.profile.RoundTripMs*float64(time.Millisecond)) + p.serverTime(sols)
+	if d <= 0 {
+		return ctx.Err()
+	}
+	t := time.NewTimer(d)
+	defer t.Stop()
+	select {
+	case <-t.C:
+		return nil
+	case <-ctx.Done():
+		return ctx.Err()
+	}
+}
+
+type syntheticDriver struct{}
+
+func (syntheticDriver) Open(string) (driver.Conn, error) {
+	return syntheticConn{}, nil
+}
+
+type syntheticConn struct{}
+
+func (c syntheticConn) Prepare(query string) (driver.Stmt, error) {
+	return c.PrepareContext(context.Background(), query)
+}
+
+func (syntheticConn) Close() error              { return nil }
+func (syntheticConn) Begin() (driver.Tx, error) { return syntheticTx{}, nil }
+
+type syntheticTx struct{}
+
+func (syntheticTx) Commit() error   { return nil }
+func (syntheticTx) Rollback() error { return nil }
+
+// Statement shapes the synthetic database understands
+type syntheticKind int
+
+const (
+	syntheticSelect syntheticKind = iota
+	syntheticSelectBatch
+	syntheticCall
+	syntheticCallBatch
+	syntheticChunk
+	syntheticWrap
+)
+
+var (
+	syntheticSelectPattern = regexp.MustCompile(`(?is)^\s*SELECT\s+(.+?)\s+FROM\s+(\w+)\s+WHERE\s+SOL_ID\s*(=|IN)`)
+	syntheticCallPattern   = regexp.MustCompile(`(?i)\b\w+\.(\w+)\s*\(`)
+)
+
+type syntheticStmt struct {
+	kind    syntheticKind
+	proc    *syntheticProc
+	columns []string
+	colIdx  []int // value column per selected column; -1 is SOL_ID, -2 is NULL
+}
+
+func (syntheticConn) PrepareContext(ctx context.Context, query string) (driver.Stmt, error) {
+	if query == "--WRAP_RESULTSET--" {
+		// godror.WrapRows turns a cursor OUT parameter into *sql.Rows with this query
+		return &syntheticStmt{kind: syntheticWrap}, nil
+	}
+	state := syntheticCurrent.Load()
+
+	if m := syntheticSelectPattern.FindStringSubmatch(query); m != nil {
+		st := &syntheticStmt{kind: syntheticSelect, proc: state.procedure(m[2])}
+		if strings.EqualFold(m[3], "IN") {
+			st.kind = syntheticSelectBatch
+		}
+		for _, name := range strings.Split(m[1], ",") {
+			name = strings.TrimSpace(name)
+			idx := slices.IndexFunc(st.proc.columns, func(c string) bool { return strings.EqualFold(c, name) })
+			if idx < 0 && strings.EqualFold(name, "SOL_ID") {
+				idx = -1
+			} else if idx < 0 {
+				idx = -2
+			}
+			st.columns = append(st.columns, name)
+			st.colIdx = append(st.colIdx, idx)
+		}
+		return st, nil
+	}
+
+	if strings.HasPrefix(strings.ToUpper(strings.TrimSpace(query)), "BEGIN") {
+		m := syntheticCallPattern.FindStringSubmatch(query)
+		if m == nil {
+			return nil, fmt.Errorf("synthetic database: no procedure call in %q", query)
+		}
+		name := m[1]
+		st := &syntheticStmt{kind: syntheticCall}
+		switch upper := strings.ToUpper(name); {
+		case strings.HasSuffix(upper, "_EXTRACT"):
+			st.kind = syntheticChunk
+			name = name[:len(name)-len("_EXTRACT")]
+		case strings.Contains(strings.ToUpper(query), "SAVEPOINT"):
+			st.kind = syntheticCallBatch
+		}
+		st.proc = state.procedure(name)
+		if st.kind == syntheticCallBatch && st.proc.profile.BatchFailure == "prepare" {
+			return nil, fmt.Errorf("ORA-06550: synthetic batch block for %s does not compile", name)
+		}
+		return st, nil
+	}
+	return nil, fmt.Errorf("synthetic database: unsupported statement %q", query)
+}
+
+func (st *syntheticStmt) Close() error  { return nil }
+func (st *syntheticStmt) NumInput() int { return -1 }
+
+// CheckNamedValue drops godror options, as godror does, and passes every other value
+// through unchanged so slices and OUT parameters reach ExecContext
+func (st *syntheticStmt) CheckNamedValue(nv *driver.NamedValue) error {
+	if _, ok := nv.Value.(godror.Option); ok {
+		return driver.ErrRemoveArgument
+	}
+	return nil
+}
+
+func (st *syntheticStmt) Exec(args []driver.Value) (driver.Result, error) {
+	return st.ExecContext(context.Background(), namedValues(args))
+}
+
+func (st *syntheticStmt) Query(args []driver.Value) (driver.Rows, error) {
+	return st.QueryContext(context.Background(), namedValues(args))
+}
+
+func namedValues(args []driver.Value) []driver.NamedValue {
+	named := make([]driver.NamedValue, len(args))
+	for i, v := range args {
+		named[i] = driver.NamedValue{Ordinal: i + 1, Value: v}
+	}
+	return named
+}
+
+func (st *syntheticStmt) ExecContext(ctx context.Context, args []driver.NamedValue) (driver.Result, error) {
+	switch st.kind {
+	case syntheticCall:
+		solID, err := stringArg(args, 0)
+		if err != nil {
+			return nil, err
+		}
+		if err := st.proc.wait(ctx, 1); err != nil {
+			return nil, err
+		}
+		return driver.RowsAffected(0), st.proc.failure(solID)
+
+	case syntheticCallBatch:
+		if len(args) < 3 {
+			return nil, errors.New("synthetic database: batched call needs SOL, status and error arguments")
+		}
+		solIDs, ok := args[0].Value.([]string)
+		statuses, ok2 := outDest[*[]int64](args[1])
+		errTexts, ok3 := outDest[*[]string](args[2])
+		if !ok || !ok2 || !ok3 {
+			return nil, errors.New("synthetic database: batched call needs []string, OUT *[]int64 and OUT *[]string")
+		}
+		if err := st.proc.wait(ctx, len(solIDs)); err != nil {
+			return nil, err
+		}
+		if st.proc.profile.BatchFailure == "execute" {
+			return nil, fmt.Errorf("ORA-03113: synthetic end-of-file on communication channel calling %s", st.proc.name)
+		}
+		*statuses = slices.Grow((*statuses)[:0], len(solIDs))[:len(solIDs)]
+		*errTexts = slices.Grow((*errTexts)[:0], len(solIDs))[:len(solIDs)]
+		for i, solID := range solIDs {
+			(*statuses)[i], (*errTexts)[i] = batchStatusSuccess, ""
+			if err := st.proc.failure(solID); err != nil {
+				(*statuses)[i], (*errTexts)[i] = batchStatusFail, err.Error()
+				if st.proc.committed(solID) {
+					(*statuses)[i] = batchStatusFailCommitted
+				}
+			}
+		}
+		return driver.RowsAffected(0), nil
+
+	case syntheticChunk:
+		solID, err := stringArg(args, 0)
+		if err != nil {
+			return nil, err
+		}
+		if len(args) < 4 {
+			return nil, errors.New("synthetic database: chunk call needs SOL, chunk, size and cursor arguments")
+		}
+		chunkNum, ok := args[1].Value.(int)
+		chunkSize, ok2 := args[2].Value.(int)
+		cursor, ok3 := outDest[*driver.Rows](args[3])
+		if !ok || !ok2 || !ok3 || chunkSize <= 0 {
+			return nil, errors.New("synthetic database: chunk call needs int chunk and size and OUT *driver.Rows")
+		}
+		if err := st.proc.wait(ctx, 1); err != nil {
+			return nil, err
+		}
+		if chunkNum == 1 {
+			if err := st.proc.failure(solID); err != nil {
+				return nil, err
+			}
+		}
+		first := (chunkNum - 1) * chunkSize
+		count := min(max(st.proc.rowCount(solID)-first, 0), chunkSize)
+		colIdx := make([]int, len(st.proc.columns))
+		for i := range colIdx {
+			colIdx[i] = i
+		}
+		*cursor = &syntheticRows{proc: st.proc, columns: st.proc.columns, colIdx: colIdx, sols: []syntheticSOL{{rows: count}}, next: first}
+		return driver.RowsAffected(0), nil
+	}
+	return nil, errors.New("synthetic database: statement is a query")
+}
+
+func (st *syntheticStmt) QueryContext(ctx context.Context, args []driver.NamedValue) (driver.Rows, error) {
+	switch st.kind {
+	case syntheticWrap:
+		if len(args) == 0 {
+			return nil, errors.New("synthetic database: nothing to wrap")
+		}
+		rows, ok := args[0].Value.(driver.Rows)
+		if !ok {
+			return nil, fmt.Errorf("synthetic database: cannot wrap %T", args[0].Value)
+		}
+		return rows, nil
+
+	case syntheticSelect, syntheticSelectBatch:
+		var solIDs []string
+		for i := range args {
+			solID, err := stringArg(args, i)
+			if err != nil {
+				return nil, err
+			}
+			solIDs = append(solIDs, solID)
+			if st.kind == syntheticSelect {
+				break
+			}
+		}
+		if len(solIDs) == 0 {
+			return nil, errors.New("synthetic database: query needs a SOL_ID")
+		}
+		// The batch query lists SOLs padded with duplicates and orders rows by SOL_ID
+		slices.Sort(solIDs)
+		solIDs = slices.Compact(solIDs)
+		if err := st.proc.wait(ctx, len(solIDs)); err != nil {
+			return nil, err
+		}
+		rows := &syntheticRows{proc: st.proc, columns: st.columns, colIdx: st.colIdx}
+		for _, solID := range solIDs {
+			if err := st.proc.failure(solID); err != nil {
+				return nil, err
+			}
+			rows.sols = append(rows.sols, syntheticSOL{id: solID, rows: st.proc.rowCount(solID)})
+		}
+		return rows, nil
+	}
+	return nil, errors.New("synthetic database: statement is not a query")
+}
+
+func stringArg(args []driver.NamedValue, i int) (string, error) {
+	if i >= len(args) {
+		return "", fmt.Errorf("synthetic database: missing argument %d", i+1)
+	}
+	s, ok := args[i].Value.(string)
+	if !ok {
+		return "", fmt.Errorf("synthetic database: argument %d is %T, expected string", i+1, args[i].Value)
+	}
+	return s, nil
+}
+
+// outDest returns the destination of an OUT parameter if it has type T
+func outDest[T any](arg driver.NamedValue) (T, bool) {
+	out, ok := arg.Value.(sql.Out)
+	if !ok {
+		var zero T
+		return zero, false
+	}
+	dest, ok := out.Dest.(T)
+	return dest, ok
+}
+
+type syntheticSOL struct {
+	id   string
+	rows int
+}
+
+// syntheticRows returns each SOL's rows in turn from the procedure's reusable values
+type syntheticRows struct {
+	proc    *syntheticProc
+	columns []string
+	colIdx  []int
+	sols    []syntheticSOL
+	sol     driver.Value // current SOL_ID, boxed once per SOL
+	next    int          // row number within the current SOL
+}
+
+func (r *syntheticRows) Columns() []string { return r.columns }
+func (r *syntheticRows) Close() error      { return nil }
+
+func (r *syntheticRows) Next(dest []driver.Value) error {
+	for len(r.sols) > 0 && r.sols[0].rows == 0 {
+		r.sols = r.sols[1:]
+		r.sol = nil
+	}
+	if len(r.sols) == 0 {
+		return io.EOF
+	}
+	if r.sol == nil {
+		id := r.sols[0].id
+		if pad := r.proc.profile.SolIDWidth - len(id); pad > 0 {
+			id += strings.Repeat(" ", pad)
+		}
+		r.sol = id
+	}
+	values := r.proc.values[r.next%syntheticValueRows]
+	for i, idx := range r.colIdx {
+		switch idx {
+		case -1:
+			dest[i] = r.sol
+		case -2:
+			dest[i] = nil
+		default:
+			dest[i] = values[idx]
+		}
+	}
+	r.next++
+	r.sols[0].rows--
+	if r.sols[0].rows == 0 {
+		r.next = 0
+	}
+	return nil
+}
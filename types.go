@@ -1,7 +1,7 @@
 package main
 
 import (
-	"sync"
+	"math"
 	"sync/atomic"
 	"time"
 )
@@ -22,6 +22,14 @@ type ColumnConfig struct {
 	Align  string
 }
 
+// Template is a procedure's column layout with its row encoder and fetch sizing, compiled once at load time
+type Template struct {
+	Columns        []ColumnConfig
+	Encoder        *RowEncoder
+	FetchArraySize int // rows per fetch round trip
+	PrefetchCount  int // rows returned with the execute
+}
+
 type ProcSummary struct {
 	Procedure string
 	StartTime time.Time
@@ -29,68 +37,74 @@ type ProcSummary struct {
 	Status    string
 }
 
-// Performance metrics for monitoring
-type PerformanceMetrics struct {
-	TotalQueries         int64
-	TotalQueryTime       int64 // nanoseconds
-	CacheHits           int64
-	CacheMisses         int64
-	TotalRowsProcessed   int64
-	TotalBytesWritten    int64
-	mu                  sync.RWMutex
-	QueryTimes          []time.Duration
-	SlowQueries         int64 // queries > 1 second
+// procSummaryState accumulates one procedure's summary with atomics so workers never lock
+type procSummaryState struct {
+	start  atomic.Int64 // earliest start, unix nanoseconds
+	end    atomic.Int64 // latest end, unix nanoseconds; zero until the first record
+	failed atomic.Bool
 }
 
-func NewPerformanceMetrics() *PerformanceMetrics {
-	return &PerformanceMetrics{
-		QueryTimes: make([]time.Duration, 0, 1000),
-	}
+// ProcSummaries collects the per-procedure summary written at the end of the run. The
+// procedure set is fixed at construction, so recording only reads the map.
+type ProcSummaries struct {
+	procs map[string]*procSummaryState
 }
 
-func (pm *PerformanceMetrics) RecordQuery(duration time.Duration, rowCount int64, bytesWritten int64) {
-	atomic.AddInt64(&pm.TotalQueries, 1)
-	atomic.AddInt64(&pm.TotalQueryTime, int64(duration))
-	atomic.AddInt64(&pm.TotalRowsProcessed, rowCount)
-	atomic.AddInt64(&pm.TotalBytesWritten, bytesWritten)
-	
-	if duration > time.Second {
-		atomic.AddInt64(&pm.SlowQueries, 1)
+func NewProcSummaries(procedures []string) *ProcSummaries {
+	procs := make(map[string]*procSummaryState, len(procedures))
+	for _, proc := range procedures {
+		s := &procSummaryState{}
+		s.start.Store(math.MaxInt64)
+		procs[proc] = s
 	}
-	
-	pm.mu.Lock()
-	if len(pm.QueryTimes) < cap(pm.QueryTimes) {
-		pm.QueryTimes = append(pm.QueryTimes, duration)
-	}
-	pm.mu.Unlock()
+	return &ProcSummaries{procs: procs}
 }
 
-func (pm *PerformanceMetrics) RecordCacheHit() {
-	atomic.AddInt64(&pm.CacheHits, 1)
-}
+// statusFailPartialCommit is the log status of a batched call that failed after the
+// procedure committed part of its work
+const statusFailPartialCommit = "FAIL_PARTIAL_COMMIT"
 
-func (pm *PerformanceMetrics) RecordCacheMiss() {
-	atomic.AddInt64(&pm.CacheMisses, 1)
-}
-
-func (pm *PerformanceMetrics) GetStats() (int64, time.Duration, float64, int64) {
-	totalQueries := atomic.LoadInt64(&pm.TotalQueries)
-	totalTime := atomic.LoadInt64(&pm.TotalQueryTime)
-	cacheHits := atomic.LoadInt64(&pm.CacheHits)
-	cacheMisses := atomic.LoadInt64(&pm.CacheMisses)
-	slowQueries := atomic.LoadInt64(&pm.SlowQueries)
-	
-	var avgDuration time.Duration
-	if totalQueries > 0 {
-		avgDuration = time.Duration(totalTime / totalQueries)
+// Record widens the procedure's time span and marks it failed on any failure
+func (ps *ProcSummaries) Record(proc string, start, end time.Time, status string) {
+	s, ok := ps.procs[proc]
+	if !ok {
+		return
+	}
+	for startNs := start.UnixNano(); ; {
+		current := s.start.Load()
+		if startNs >= current || s.start.CompareAndSwap(current, startNs) {
+			break
+		}
+	}
+	for endNs := end.UnixNano(); ; {
+		current := s.end.Load()
+		if endNs <= current || s.end.CompareAndSwap(current, endNs) {
+			break
+		}
 	}
-	
-	var cacheHitRate float64
-	if cacheHits+cacheMisses > 0 {
-		cacheHitRate = float64(cacheHits) / float64(cacheHits+cacheMisses) * 100
+	if status != "SUCCESS" {
+		s.failed.Store(true)
 	}
-	
-	return totalQueries, avgDuration, cacheHitRate, slowQueries
 }
 
-var globalMetrics = NewPerformanceMetrics()
+// Snapshot returns the summary of every procedure that recorded at least one outcome
+func (ps *ProcSummaries) Snapshot() map[string]ProcSummary {
+	summary := make(map[string]ProcSummary, len(ps.procs))
+	for proc, s := range ps.procs {
+		end := s.end.Load()
+		if end == 0 {
+			continue
+		}
+		status := "SUCCESS"
+		if s.failed.Load() {
+			status = "FAIL"
+		}
+		summary[proc] = ProcSummary{
+			Procedure: proc,
+			StartTime: time.Unix(0, s.start.Load()),
+			EndTime:   time.Unix(0, end),
+			Status:    status,
+		}
+	}
+	return summary
+}
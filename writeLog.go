@@ -7,8 +7,16 @@ import (
 	"log/slog"
 	"os"
 	"slices"
+	"time"
 )
 
+// sendProcLog queues a record for writeLog, timing the wait when the log falls behind
+func sendProcLog(logCh chan<- ProcLog, plog ProcLog) {
+	start := time.Now()
+	logCh <- plog
+	globalMetrics.RecordPhase(plog.Procedure, PhaseLog, time.Since(start))
+}
+
 // Optimized async logging with batching to reduce I/O bottlenecks
 func writeLog(path string, logCh <-chan ProcLog) {
 	file, err := os.Create(path)